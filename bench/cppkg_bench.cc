@@ -0,0 +1,287 @@
+// Measures cppkg's own overhead on generated projects: tree scanning,
+// config parsing, dependency resolution, no-op builds and how a full build
+// scales with -j. Results go to stdout (or --output) as JSON so runs can be
+// compared; a readable table goes to stderr.
+#define CLI11_IMPLEMENTATION
+#include "CLI/CLI.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+#include "process.hpp"
+#include "registry.hpp"
+#include "resolver.hpp"
+#include "state.hpp"
+
+#ifndef CPPKG_BINARY
+#define CPPKG_BINARY "cppkg"
+#endif
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+namespace {
+
+struct BenchConfig {
+    std::vector<size_t> sizes = {1000, 10000, 100000};
+    std::vector<size_t> jobs = {1, 2, 4};
+    size_t repetitions = 5;
+    size_t depth = 16;        // length of each header include chain
+    size_t dependencies = 50; // packages in the generated lock
+    size_t registry = 300;    // packages in the generated registry
+    std::string work_dir;
+    std::string output;
+    std::string cppkg = CPPKG_BINARY;
+};
+
+json results = json::array();
+
+void report(const std::string& name, size_t files, double value, const std::string& unit) {
+    results.push_back({{"benchmark", name}, {"files", files}, {"value", value}, {"unit", unit}});
+    std::cerr << std::left << std::setw(28) << name << std::right << std::setw(8) << files
+              << std::setw(12) << std::fixed << std::setprecision(3) << value << " " << unit << "\n";
+}
+
+template <typename F>
+double medianMs(size_t repetitions, F&& run) {
+    std::vector<double> samples;
+    for (size_t i = 0; i < std::max<size_t>(1, repetitions); ++i) {
+        auto begin = std::chrono::steady_clock::now();
+        run();
+        samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+void writeFile(const fs::path& path, const std::string& content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << content;
+}
+
+// A project of `files` files: ~1% sources (capped at 64), ~10% headers in
+// include chains of `depth`, and the rest data files that only cost a
+// directory entry each. Its lock names `dependencies` header-only packages
+// that are already unpacked under _packages/.
+void generateProject(const fs::path& root, size_t files, const BenchConfig& config) {
+    fs::remove_all(root);
+
+    size_t sources = std::clamp<size_t>(files / 100, 4, 64);
+    size_t headers = std::max(sources * config.depth, files / 10);
+    size_t data = files > sources + headers ? files - sources - headers : 0;
+
+    // Headers live 500 to a directory, each including the next one of its
+    // chain so every source pulls in a full chain.
+    for (size_t i = 0; i < headers; ++i) {
+        fs::path dir = root / "include" / ("group" + std::to_string(i / 500));
+        std::string text = "#pragma once\n";
+        bool chained = (i + 1) % config.depth != 0 && (i + 1) / 500 == i / 500;
+        if (chained) text += "#include \"h" + std::to_string(i + 1) + ".hpp\"\n";
+        text += "inline int h" + std::to_string(i) + "() { return " + std::to_string(i) + "; }\n";
+        writeFile(dir / ("h" + std::to_string(i) + ".hpp"), text);
+    }
+
+    size_t chains = std::max<size_t>(1, headers / config.depth);
+    for (size_t i = 0; i < sources; ++i) {
+        size_t head = (i % chains) * config.depth;
+        writeFile(root / "src" / ("module" + std::to_string(i / 16)) / ("s" + std::to_string(i) + ".cpp"),
+                  "#include <h" + std::to_string(head) + ".hpp>\nint s" + std::to_string(i) +
+                  "() { return h" + std::to_string(head) + "(); }\n");
+    }
+    writeFile(root / "src" / "main.cpp", "int main() { return 0; }\n");
+
+    for (size_t i = 0; i < data; ++i) {
+        writeFile(root / "assets" / ("d" + std::to_string(i / 1000)) / ("a" + std::to_string(i) + ".txt"), "x\n");
+    }
+
+    json config_file = {
+        {"name", "bench"}, {"version", "0.1.0"}, {"cpp_version", "c++17"}, {"exec", "src/main.cpp"},
+        {"dependencies", json::object()}
+    };
+    json lock = {{"version", 1}, {"requires", json::object()}, {"packages", json::object()}};
+    for (size_t i = 0; i < config.dependencies; ++i) {
+        std::string name = "dep" + std::to_string(i);
+        std::string sha = std::string(64, 'a');
+        config_file["dependencies"][name] = "^1.0.0";
+        lock["requires"][name] = "^1.0.0";
+        lock["packages"][name] = {
+            {"version", "1.0.0"}, {"url", "file:///dev/null"}, {"sha256", sha}, {"type", "header-only"},
+            {"include", "include"}, {"library", ""}, {"dependencies", json::object()}
+        };
+        fs::path package = root / "_packages" / name / "1.0.0";
+        writeFile(package / "include" / (name + ".hpp"), "#pragma once\n");
+        writeFile(package / ".cppkg-sha256", sha + "\n");
+    }
+    writeFile(root / "cppkg.json", config_file.dump(2));
+    writeFile(root / "cppkg.lock", lock.dump(2));
+}
+
+// `count` packages with five 1.x releases each; every release depends on up
+// to three lower-numbered packages, some with narrowed ranges, so the
+// resolver has real choices to make.
+void generateRegistry(const fs::path& root, size_t count) {
+    fs::remove_all(root);
+    fs::create_directories(root);
+    std::mt19937 random(42);
+
+    for (size_t i = 0; i < count; ++i) {
+        json index = {{"versions", json::object()}};
+        for (int minor = 0; minor < 5; ++minor) {
+            json release = {{"url", "file:///dev/null"}, {"sha256", ""}, {"dependencies", json::object()}};
+            for (int d = 0; d < 3 && i > 0; ++d) {
+                size_t dep = random() % i;
+                const char* ranges[] = {"^1.0.0", "^1.0.0", ">=1.1.0 <1.4.0", "^1.2.0"};
+                release["dependencies"]["p" + std::to_string(dep)] = ranges[random() % 4];
+            }
+            index["versions"]["1." + std::to_string(minor) + ".0"] = release;
+        }
+        std::ofstream(root / ("p" + std::to_string(i) + ".json")) << index.dump();
+    }
+}
+
+ProcessResult cppkg(const BenchConfig& config, const std::vector<std::string>& args) {
+    std::vector<std::string> argv = {config.cppkg};
+    argv.insert(argv.end(), args.begin(), args.end());
+    return runProcess(argv);
+}
+
+void benchProject(const fs::path& root, size_t files, const BenchConfig& config, bool compile_scaling) {
+    generateProject(root, files, config);
+    fs::current_path(root);
+
+    report("config_parse", files, medianMs(config.repetitions * 20, []() {
+        json parsed = json::parse(std::ifstream("cppkg.json"));
+        (void)parsed;
+    }), "ms");
+
+    report("scan_cold", files, medianMs(config.repetitions, []() {
+        BuildState state;
+        scanTree(".", state);
+    }), "ms");
+
+    BuildState warm;
+    scanTree(".", warm);
+    warm.save("bench.state");
+    report("scan_warm", files, medianMs(config.repetitions, []() {
+        BuildState state;
+        state.load("bench.state");
+        scanTree(".", state);
+    }), "ms");
+
+    // What getSourceFiles() and findHeaderDirectories() do with the tree.
+    report("discover_sources_headers", files, medianMs(config.repetitions, []() {
+        BuildState state;
+        state.load("bench.state");
+        size_t sources = 0;
+        std::vector<std::string> header_dirs;
+        for (const auto& file : scanTree(".", state)) {
+            fs::path path(file);
+            auto extension = path.extension();
+            if (extension == ".cpp") ++sources;
+            if (extension == ".hpp" || extension == ".h") header_dirs.push_back(path.parent_path().string());
+        }
+        std::sort(header_dirs.begin(), header_dirs.end());
+        header_dirs.erase(std::unique(header_dirs.begin(), header_dirs.end()), header_dirs.end());
+    }), "ms");
+    fs::remove("bench.state");
+
+    if (compile_scaling) {
+        for (size_t jobs : config.jobs) {
+            ProcessResult result;
+            double ms = medianMs(1, [&]() {
+                fs::remove_all("build");
+                result = cppkg(config, {"build", "--no-cache", "-j", std::to_string(jobs)});
+            });
+            if (result.exit_code != 0) {
+                std::cerr << "cppkg build -j " << jobs << " failed in " << root << ":\n" << result.output;
+                return;
+            }
+            report("build_full_j" + std::to_string(jobs), files, ms, "ms");
+        }
+    }
+
+    ProcessResult first = cppkg(config, {"build", "-j", "0"});
+    if (first.exit_code != 0) {
+        std::cerr << "cppkg build failed in " << root << ":\n" << first.output;
+        return;
+    }
+    report("build_noop", files, medianMs(config.repetitions, [&]() {
+        cppkg(config, {"build"});
+    }), "ms");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    CLI::App app{"cppkg_bench: measure cppkg's own overhead on synthetic projects"};
+
+    BenchConfig config;
+    app.add_option("--sizes", config.sizes, "Project sizes in files")->delimiter(',')->capture_default_str();
+    app.add_option("--jobs", config.jobs, "-j values for the full-build scaling run")->delimiter(',')->capture_default_str();
+    app.add_option("--repetitions", config.repetitions, "Samples per measurement (the median is reported)")->capture_default_str();
+    app.add_option("--depth", config.depth, "Length of each header include chain")->capture_default_str();
+    app.add_option("--dependencies", config.dependencies, "Locked packages per project")->capture_default_str();
+    app.add_option("--registry", config.registry, "Packages in the synthetic registry")->capture_default_str();
+    app.add_option("--work-dir", config.work_dir, "Where projects are generated (default: a temp directory)");
+    app.add_option("--output", config.output, "Write JSON results here instead of stdout");
+    app.add_option("--cppkg", config.cppkg, "cppkg binary to benchmark")->capture_default_str();
+
+    try {
+        app.parse(argc, argv);
+    } catch (const CLI::ParseError& e) {
+        return app.exit(e);
+    }
+
+    try {
+        fs::path work = config.work_dir.empty() ? fs::temp_directory_path() / "cppkg_bench" : fs::path(config.work_dir);
+        work = fs::absolute(work);
+        fs::create_directories(work);
+        config.cppkg = fs::exists(config.cppkg) ? fs::absolute(config.cppkg).string() : config.cppkg;
+        if (!config.output.empty()) config.output = fs::absolute(config.output).string();
+
+        // Keep the user's compilation cache out of it.
+        std::string cache = (work / "cache").string();
+#ifdef _WIN32
+        _putenv_s("CPPKG_CACHE_DIR", cache.c_str());
+#else
+        setenv("CPPKG_CACHE_DIR", cache.c_str(), 1);
+#endif
+
+        fs::path registry = work / "registry";
+        generateRegistry(registry, config.registry);
+        std::map<std::string, std::string> roots;
+        for (size_t i = config.registry > 10 ? config.registry - 10 : 0; i < config.registry; ++i) {
+            roots["p" + std::to_string(i)] = "*";
+        }
+        report("resolve", config.registry, medianMs(config.repetitions, [&]() {
+            Registry index(registry);
+            Resolver(index).resolve(roots);
+        }), "ms");
+
+        std::vector<size_t> sizes = config.sizes;
+        std::sort(sizes.begin(), sizes.end());
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            benchProject(work / ("project_" + std::to_string(sizes[i])), sizes[i], config, i == 0);
+        }
+        fs::current_path(work);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    json document = {{"cppkg_bench", 1}, {"results", results}};
+    if (config.output.empty()) {
+        std::cout << document.dump(2) << std::endl;
+    } else {
+        std::ofstream(config.output) << document.dump(2) << "\n";
+    }
+    return 0;
+}
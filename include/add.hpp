@@ -2,15 +2,38 @@
 #define QUICK_CPPKG_ADD_HPP
 
 #include "command.hpp"
+#include "lockfile.hpp"
+#include "registry.hpp"
+#include "semver.hpp"
+#include "nlohmann/json.hpp"
+#include <filesystem>
+#include <fstream>
 #include <vector> 
 #include <iostream>
 #include <string>
 
+namespace fs = std::filesystem;
+
 class AddHandler : public CommandHandler {
 public:
     AddHandler(const std::vector<std::string>& packages) : packages_(packages) {}
 
     void execute() override {
+        if (!fs::exists("cppkg.json")) {
+            std::cerr << "Error: cppkg.json not found. Run 'cppkg init' first\n";
+            return;
+        }
+
+        // ordered_json keeps the user's key order when cppkg.json is rewritten.
+        nlohmann::ordered_json config = nlohmann::ordered_json::parse(std::ifstream("cppkg.json"));
+        if (!config.contains("dependencies") || !config["dependencies"].is_object()) {
+            config["dependencies"] = nlohmann::ordered_json::object();
+        }
+
+        Registry registry(Registry::locate(config.value("registry", "")));
+        std::vector<std::string> added;
+        std::vector<std::string> unpinned;
+
         for (const auto& package : packages_) {
             size_t at_pos = package.find('@');
             std::string name = (at_pos != std::string::npos) 
@@ -23,9 +46,45 @@ public:
                 continue;
             }
 
-            std::cout << "Added package: " << name 
-                      << " (version: " << version << ")\n";
+            if (!registry.contains(name)) {
+                std::cerr << "Error: Package '" << name << "' not found in registry "
+                          << registry.root().string() << "\n";
+                continue;
+            }
+
+            if (version.empty() || version == "latest") {
+                version = "*";
+                unpinned.push_back(name);
+            } else {
+                VersionConstraint::parse(version);
+            }
+
+            config["dependencies"][name] = version;
+            added.push_back(name);
+        }
+
+        if (added.empty()) return;
+
+        // Resolve before touching any file so a conflict leaves the project as it was.
+        Lockfile lock = resolveLockfile(registry, declaredDependencies(config));
+
+        // Packages added without a version get "^<resolved>", i.e. the newest
+        // release that fits the rest of the graph.
+        for (const auto& name : unpinned) {
+            std::string constraint = "^" + lock.packages.at(name).version.toString();
+            config["dependencies"][name] = constraint;
+            lock.requirements[name] = constraint;
+        }
+
+        std::ofstream("cppkg.json") << config.dump(2) << "\n";
+        lock.save();
+
+        for (const auto& name : added) {
+            std::cout << "Added package: " << name
+                      << " (version: " << config["dependencies"][name].get<std::string>()
+                      << ", locked " << lock.packages.at(name).version.toString() << ")\n";
         }
+        std::cout << "Locked " << lock.packages.size() << " package(s) in cppkg.lock\n";
     }
 
 private:
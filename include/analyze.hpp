@@ -0,0 +1,662 @@
+#ifndef QUICK_CPPKG_ANALYZE_HPP
+#define QUICK_CPPKG_ANALYZE_HPP
+
+#define RESET   "\033[0m"
+#define YELLOW  "\033[33m"
+#define GREY    "\033[90m"
+
+#include "command.hpp"
+#include "includes.hpp"
+#include "modules.hpp"
+#include "nlohmann/json.hpp"
+#include "pch.hpp"
+#include "process.hpp"
+#include "scheduler.hpp"
+#include "state.hpp"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+// What a header or source says about names, read without preprocessing.
+struct SourceNames {
+    std::unordered_set<std::string> used;     // every identifier outside #include and #define lines
+    std::unordered_set<std::string> declared; // names it declares at namespace scope, and its macros
+};
+
+// Declarations are recognised by shape: an identifier at namespace scope
+// (outside class bodies, function bodies and parentheses) followed by one
+// of `( = ; [ { :`, e.g. `int add(`, `struct Point {`, `using Id =`,
+// `extern int count;`. That misses some and finds a few names that are not
+// declarations, which only makes an include look used.
+inline SourceNames scanSourceNames(const std::string& path) {
+    static const std::unordered_set<std::string> keywords = {
+        "alignas", "alignof", "asm", "auto", "bool", "case", "char", "class", "concept", "const", "consteval",
+        "constexpr", "constinit", "decltype", "default", "defined", "delete", "do", "double", "else", "enum",
+        "explicit", "export", "extern", "final", "float", "for", "friend", "if", "import", "inline", "int", "long",
+        "module", "mutable", "namespace", "new", "noexcept", "operator", "override", "private", "protected",
+        "public", "register", "requires", "return", "short", "signed", "sizeof", "static", "static_assert",
+        "struct", "switch", "template", "this", "thread_local", "throw", "typedef", "typename", "union",
+        "unsigned", "using", "virtual", "void", "volatile", "while", "__attribute__", "__declspec"};
+
+    SourceNames names;
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return names;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string text = buffer.str();
+
+    auto isIdentifierStart = [](char c) { return std::isalpha(static_cast<unsigned char>(c)) || c == '_'; };
+    auto isIdentifierChar = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; };
+
+    // Identifiers, "::", and every other non-blank character on its own.
+    std::vector<std::string> tokens;
+    size_t i = 0;
+    bool line_start = true;
+    while (i < text.size()) {
+        char c = text[i];
+        if (c == '\n') {
+            line_start = true;
+            ++i;
+        } else if (std::isspace(static_cast<unsigned char>(c))) {
+            ++i;
+        } else if (c == '#' && line_start) {
+            size_t begin = text.find_first_not_of(" \t", i + 1);
+            size_t end = begin;
+            while (end < text.size() && isIdentifierChar(text[end])) ++end;
+            std::string directive = begin == std::string::npos ? "" : text.substr(begin, end - begin);
+            if (directive == "include" || directive == "define") {
+                if (directive == "define") {
+                    size_t name = text.find_first_not_of(" \t", end);
+                    size_t name_end = name;
+                    while (name_end < text.size() && isIdentifierChar(text[name_end])) ++name_end;
+                    if (name != std::string::npos && name_end > name) names.declared.insert(text.substr(name, name_end - name));
+                }
+                while (i < text.size() && text[i] != '\n') {
+                    if (text[i] == '\\' && i + 1 < text.size() && text[i + 1] == '\n') ++i;
+                    ++i;
+                }
+            } else {
+                // Names tested by #if and #ifdef count as used.
+                i = end;
+                line_start = false;
+            }
+        } else if (text.compare(i, 2, "//") == 0) {
+            while (i < text.size() && text[i] != '\n') ++i;
+        } else if (text.compare(i, 2, "/*") == 0) {
+            size_t end = text.find("*/", i + 2);
+            i = end == std::string::npos ? text.size() : end + 2;
+        } else if (c == 'R' && i + 1 < text.size() && text[i + 1] == '"') {
+            size_t open = text.find('(', i + 2);
+            if (open == std::string::npos) break;
+            std::string close = ")" + text.substr(i + 2, open - i - 2) + "\"";
+            size_t end = text.find(close, open);
+            i = end == std::string::npos ? text.size() : end + close.size();
+            tokens.push_back("\"");
+            line_start = false;
+        } else if (c == '"' || c == '\'') {
+            ++i;
+            while (i < text.size() && text[i] != c && text[i] != '\n') {
+                i += text[i] == '\\' ? 2 : 1;
+            }
+            ++i;
+            tokens.push_back(std::string(1, c));
+            line_start = false;
+        } else if (isIdentifierStart(c)) {
+            size_t begin = i;
+            while (i < text.size() && isIdentifierChar(text[i])) ++i;
+            tokens.push_back(text.substr(begin, i - begin));
+            line_start = false;
+        } else if (text.compare(i, 2, "::") == 0) {
+            tokens.push_back("::");
+            i += 2;
+            line_start = false;
+        } else {
+            tokens.push_back(std::string(1, c));
+            ++i;
+            line_start = false;
+        }
+    }
+
+    static const std::unordered_set<std::string> followers = {"(", "=", ";", "[", "{", ":"};
+    std::vector<bool> scopes; // open braces; true for namespace and extern "C" blocks
+    size_t depth = 0;         // braces that are not namespaces
+    size_t parens = 0;
+    bool namespace_block = false; // a namespace or extern "C" declaration is under way
+    for (size_t k = 0; k < tokens.size(); ++k) {
+        const std::string& token = tokens[k];
+        if (isIdentifierStart(token[0])) {
+            names.used.insert(token);
+            if (token == "namespace" || (token == "extern" && k + 1 < tokens.size() && tokens[k + 1] == "\"")) {
+                namespace_block = true;
+            }
+            bool after_namespace = k > 0 && tokens[k - 1] == "namespace";
+            if (depth == 0 && parens == 0 && !after_namespace && !keywords.count(token) && k + 1 < tokens.size() &&
+                followers.count(tokens[k + 1])) {
+                names.declared.insert(token);
+            }
+        } else if (token == "(") {
+            ++parens;
+        } else if (token == ")") {
+            if (parens > 0) --parens;
+        } else if (token == "{") {
+            scopes.push_back(namespace_block);
+            if (!namespace_block) ++depth;
+            namespace_block = false;
+        } else if (token == "}") {
+            if (!scopes.empty()) {
+                if (!scopes.back() && depth > 0) --depth;
+                scopes.pop_back();
+            }
+        } else if (token == ";") {
+            namespace_block = false;
+        }
+    }
+    return names;
+}
+
+// `cppkg analyze includes`: what headers cost the last build of a profile.
+// For every header the depfiles list it reports how many translation units
+// pull it in, its size before and after preprocessing, and an estimated
+// parse cost, the preprocessed size times the number of translation units.
+// Where clang's -ftime-trace files from `cppkg build --trace` are next to
+// the objects, the time they measured is reported as well. It also lists
+// includes that are redundant or look unused, and the headers that are best
+// precompiled.
+class AnalyzeHandler : public CommandHandler {
+public:
+    AnalyzeHandler(std::string action, std::string profile, size_t top, size_t jobs)
+        : action_(std::move(action)), profile_(std::move(profile)), top_(top), jobs_(jobs) {}
+
+    void execute() override {
+        if (action_ == "includes") {
+            analyzeIncludes();
+        }
+    }
+
+private:
+    // Smaller headers parse about as fast as a PCH loads.
+    static constexpr uintmax_t kMinPchSize = 64 * 1024;
+
+    struct Unit {
+        std::string object;
+        std::string source;
+        std::vector<std::string> arguments; // from compile_commands.json; empty if unknown
+        std::set<std::string> files;        // every header it read
+    };
+
+    struct Header {
+        std::string path;
+        std::vector<size_t> units;   // indexes into units_
+        uintmax_t size = 0;
+        uintmax_t preprocessed = 0;  // 0 if it could not be preprocessed on its own
+        double measured = 0;         // seconds clang spent in it over all units
+        double cost() const { return double(units.size()) * double(preprocessed ? preprocessed : size); }
+    };
+
+    std::string action_;
+    std::string profile_;
+    size_t top_;
+    size_t jobs_;
+
+    std::vector<Unit> units_;
+    std::map<std::string, Header> headers_;
+    std::map<std::string, std::set<size_t>> files_;             // file (source or header) -> units reading it
+    std::map<std::string, std::vector<std::string>> includes_;  // file -> headers it includes directly
+    std::map<std::string, std::vector<std::string>> spellings_; // header -> how files spell its #include
+    std::map<std::string, SourceNames> names_;
+    std::map<std::string, std::set<std::string>> reachable_;
+
+    void analyzeIncludes() {
+        json config = json::parse(std::ifstream("cppkg.json"));
+        std::string out_dir = "build/" + profile_;
+        loadUnits(out_dir);
+        if (units_.empty() || headers_.empty()) {
+            std::cout << "No headers in the last " << profile_ << " build" << std::endl;
+            return;
+        }
+
+        measurePreprocessed(out_dir);
+        bool measured = readTimeTraces();
+        resolveIncludes();
+
+        std::vector<const Header*> ranked;
+        for (const auto& [path, header] : headers_) ranked.push_back(&header);
+        std::stable_sort(ranked.begin(), ranked.end(), [measured](const Header* a, const Header* b) {
+            return measured && a->measured != b->measured ? a->measured > b->measured : a->cost() > b->cost();
+        });
+
+        std::cout << "📊 Includes of the last " << profile_ << " build: " << units_.size() << " translation unit(s), "
+                  << headers_.size() << " header(s)";
+        if (measured) std::cout << ", with clang time traces";
+        std::cout << "\n\n";
+        reportCosts(ranked, measured);
+        reportRedundant();
+        reportUnused();
+        reportPch(ranked, config);
+    }
+
+    // The object files of the last build and the headers their depfiles
+    // named, as the build state recorded them.
+    void loadUnits(const std::string& out_dir) {
+        std::string state_path = out_dir + "/.cppkg_state";
+        BuildState state;
+        if (!state.load(state_path) || state.steps.empty()) {
+            throw std::runtime_error("No build state in " + state_path + "; run `cppkg build --profile " + profile_ + "` first");
+        }
+
+        std::map<std::string, json> commands;
+        std::ifstream commands_file("build/compile_commands.json");
+        if (commands_file) {
+            json entries = json::parse(commands_file, nullptr, false);
+            if (entries.is_array()) {
+                for (const auto& entry : entries) {
+                    if (entry.contains("output")) commands[entry["output"].get<std::string>()] = entry;
+                }
+            }
+        }
+
+        std::vector<std::string> objects;
+        for (const auto& [object, record] : state.steps) {
+            std::string extension = fs::path(object).extension().string();
+            if (extension == ".o" || extension == ".obj") objects.push_back(object);
+        }
+        std::sort(objects.begin(), objects.end());
+
+        for (const auto& object : objects) {
+            Unit unit;
+            unit.object = object;
+            auto command = commands.find(object);
+            if (command != commands.end()) {
+                unit.source = command->second.value("file", "");
+                unit.arguments = command->second.value("arguments", std::vector<std::string>{});
+            }
+            for (const auto& prerequisite : state.steps[object].prerequisites) {
+                std::string path = relativePath(prerequisite.path);
+                std::string extension = fs::path(path).extension().string();
+                // BMIs and precompiled headers are read, but not parsed.
+                if (extension == ".pcm" || extension == ".gcm" || extension == ".ifc" || extension == ".gch" ||
+                    extension == ".pch") {
+                    continue;
+                }
+                if (unit.source.empty() && !isHeaderFile(path)) unit.source = path;
+                if (path != unit.source) unit.files.insert(path);
+            }
+
+            size_t index = units_.size();
+            files_[unit.source].insert(index);
+            for (const auto& path : unit.files) {
+                files_[path].insert(index);
+                Header& header = headers_[path];
+                header.path = path;
+                header.units.push_back(index);
+            }
+            units_.push_back(std::move(unit));
+        }
+
+        for (auto& [path, header] : headers_) {
+            std::error_code ec;
+            header.size = fs::file_size(path, ec);
+            if (ec) header.size = 0;
+        }
+    }
+
+    // Preprocesses every header on its own, with the flags of a unit that
+    // includes it, and records the size of what the compiler has to parse.
+    void measurePreprocessed(const std::string& out_dir) {
+        std::string dir = out_dir + "/analyze";
+        fs::create_directories(dir);
+        JobScheduler scheduler(jobs_);
+        size_t index = 0;
+        for (auto& [path, header] : headers_) {
+            const Unit& unit = units_[header.units.front()];
+            if (unit.arguments.empty() || unit.arguments[0] == "cl") continue;
+            Header* current = &header;
+            std::string stub = dir + "/" + std::to_string(index++);
+            std::vector<std::string> command = preprocessCommand(unit, stub + ".cpp", stub + ".ii");
+            scheduler.add([current, stub, command]() {
+                std::ofstream(stub + ".cpp") << "#include \"" << fs::absolute(current->path).generic_string() << "\"\n";
+                if (runProcess(command).exit_code == 0) {
+                    std::error_code ec;
+                    current->preprocessed = fs::file_size(stub + ".ii", ec);
+                    if (ec) current->preprocessed = 0;
+                }
+                std::error_code ec;
+                fs::remove(stub + ".cpp", ec);
+                fs::remove(stub + ".ii", ec);
+                return JobResult{};
+            });
+        }
+        scheduler.run();
+    }
+
+    // A unit's compile command turned into one that preprocesses `stub`,
+    // without line markers, into `output`.
+    static std::vector<std::string> preprocessCommand(const Unit& unit, const std::string& stub, const std::string& output) {
+        const auto& args = unit.arguments;
+        std::vector<std::string> command = {args[0]};
+        for (size_t i = 1; i < args.size(); ++i) {
+            const std::string& arg = args[i];
+            if (arg == "-o" || arg == "-MF" || arg == "-MT" || arg == "-MQ" || arg == "-x") {
+                ++i;
+            } else if (arg == "-c" || arg == "-MMD" || arg == "-MD" ||
+                       fs::path(arg).lexically_normal().generic_string() == unit.source ||
+                       arg.rfind("-fmodule", 0) == 0 || arg.rfind("-fprebuilt-module-path", 0) == 0 ||
+                       arg == "-ftime-trace") {
+                continue;
+            } else {
+                command.push_back(arg);
+            }
+        }
+        command.insert(command.end(), {"-E", "-P", "-x", "c++", stub, "-o", output});
+        return command;
+    }
+
+    // Sums the "Source" events of clang's -ftime-trace files, which span the
+    // parsing of a header including everything it includes. A trace older
+    // than its object belongs to an earlier compile and is ignored.
+    bool readTimeTraces() {
+        bool found = false;
+        for (const auto& unit : units_) {
+            fs::path object(unit.object);
+            std::string trace = (object.parent_path() / object.stem()).string() + ".json";
+            std::error_code ec;
+            auto trace_time = fs::last_write_time(trace, ec);
+            if (ec || trace_time < fs::last_write_time(object, ec)) continue;
+
+            std::ifstream file(trace);
+            json data = json::parse(file, nullptr, false);
+            if (data.is_discarded() || !data.contains("traceEvents")) continue;
+            found = true;
+            for (const auto& event : data["traceEvents"]) {
+                if (event.value("name", "") != "Source" || !event.contains("dur") || !event.contains("args")) continue;
+                auto header = headers_.find(relativePath(event["args"].value("detail", "")));
+                if (header != headers_.end()) header->second.measured += event["dur"].get<double>() / 1e6;
+            }
+        }
+        return found;
+    }
+
+    // Reads the #include lines of every source and header of the build and
+    // matches each against the files the including unit actually read:
+    // first next to the including file, then as a path suffix.
+    void resolveIncludes() {
+        for (const auto& [file, units] : files_) {
+            const Unit& unit = units_[*units.begin()];
+            std::set<std::string> seen;
+            for (const auto& spelled : scanIncludes(file)) {
+                std::string local = (fs::path(file).parent_path() / spelled).lexically_normal().generic_string();
+                std::string wanted = fs::path(spelled).lexically_normal().generic_string();
+                std::string found;
+                if (unit.files.count(local)) {
+                    found = local;
+                } else {
+                    for (const auto& candidate : unit.files) {
+                        if (candidate == wanted || (candidate.size() > wanted.size() &&
+                            candidate.compare(candidate.size() - wanted.size(), wanted.size(), wanted) == 0 &&
+                            candidate[candidate.size() - wanted.size() - 1] == '/')) {
+                            found = candidate;
+                            break;
+                        }
+                    }
+                }
+                if (found.empty() || !seen.insert(found).second) continue;
+                includes_[file].push_back(found);
+                spellings_[found].push_back(spelled);
+            }
+        }
+    }
+
+    // Headers reachable from `header` through #include lines, itself included.
+    const std::set<std::string>& reachable(const std::string& header) {
+        auto known = reachable_.find(header);
+        if (known != reachable_.end()) return known->second;
+
+        std::set<std::string> seen = {header};
+        std::vector<std::string> pending = {header};
+        while (!pending.empty()) {
+            std::string current = pending.back();
+            pending.pop_back();
+            auto it = includes_.find(current);
+            if (it == includes_.end()) continue;
+            for (const auto& next : it->second) {
+                if (seen.insert(next).second) pending.push_back(next);
+            }
+        }
+        return reachable_[header] = std::move(seen);
+    }
+
+    const SourceNames& names(const std::string& path) {
+        auto it = names_.find(path);
+        if (it == names_.end()) it = names_.emplace(path, scanSourceNames(path)).first;
+        return it->second;
+    }
+
+    // Files of the project itself, as opposed to dependencies in _packages/
+    // or outside the project directory.
+    static bool isProjectFile(const std::string& path) {
+        return fs::path(path).is_relative() && path.rfind("..", 0) != 0 && path.rfind("_packages/", 0) != 0 &&
+               path.rfind("build/", 0) != 0;
+    }
+
+    // Third-party code kept in the project tree.
+    static bool isVendored(const std::string& path) {
+        for (const auto& part : fs::path(path)) {
+            std::string name = part.string();
+            if (name == "third_party" || name == "vendor" || name == "external") return true;
+        }
+        return false;
+    }
+
+    static std::string relativePath(const std::string& path) {
+        fs::path normal = fs::path(path).lexically_normal();
+        if (normal.is_absolute()) {
+            fs::path relative = normal.lexically_relative(fs::current_path());
+            if (!relative.empty() && relative.generic_string().rfind("..", 0) != 0) normal = relative;
+        }
+        return normal.generic_string();
+    }
+
+    static std::string formatBytes(double bytes) {
+        std::ostringstream text;
+        text << std::fixed << std::setprecision(1);
+        if (bytes >= 1024.0 * 1024 * 1024) {
+            text << bytes / (1024.0 * 1024 * 1024) << " GiB";
+        } else if (bytes >= 1024.0 * 1024) {
+            text << bytes / (1024.0 * 1024) << " MiB";
+        } else if (bytes >= 1024) {
+            text << bytes / 1024 << " KiB";
+        } else {
+            text << std::setprecision(0) << bytes << " B";
+        }
+        return text.str();
+    }
+
+    void reportCosts(const std::vector<const Header*>& ranked, bool measured) {
+        size_t width = 6;
+        for (size_t i = 0; i < ranked.size() && i < top_; ++i) width = std::max(width, ranked[i]->path.size());
+
+        std::cout << std::left << std::setw(width) << "Header" << std::right << std::setw(10) << "TUs" << std::setw(12)
+                  << "size" << std::setw(14) << "preprocessed" << std::setw(13) << "parse cost";
+        if (measured) std::cout << std::setw(11) << "measured";
+        std::cout << "\n";
+
+        std::string units = std::to_string(units_.size());
+        for (size_t i = 0; i < ranked.size() && i < top_; ++i) {
+            const Header& header = *ranked[i];
+            std::cout << std::left << std::setw(width) << header.path << std::right << std::setw(10)
+                      << std::to_string(header.units.size()) + "/" + units << std::setw(12) << formatBytes(header.size)
+                      << std::setw(14) << (header.preprocessed ? formatBytes(header.preprocessed) : "-") << std::setw(13)
+                      << formatBytes(header.cost());
+            if (measured) {
+                std::ostringstream seconds;
+                seconds << std::fixed << std::setprecision(2) << header.measured << " s";
+                std::cout << std::setw(11) << seconds.str();
+            }
+            std::cout << "\n";
+
+            // Who pulls the header in, weighted by how many units read them.
+            std::vector<std::pair<size_t, std::string>> includers;
+            for (const auto& [file, included] : includes_) {
+                if (std::find(included.begin(), included.end(), header.path) != included.end()) {
+                    includers.push_back({files_[file].size(), file});
+                }
+            }
+            std::sort(includers.begin(), includers.end(), [](const auto& a, const auto& b) {
+                return a.first != b.first ? a.first > b.first : a.second < b.second;
+            });
+            if (includers.empty()) continue;
+            std::cout << GREY << "    via ";
+            for (size_t k = 0; k < includers.size() && k < 3; ++k) {
+                std::cout << (k ? ", " : "") << includers[k].second << " (" << includers[k].first << ")";
+            }
+            if (includers.size() > 3) std::cout << " and " << includers.size() - 3 << " more";
+            std::cout << RESET << "\n";
+        }
+        if (ranked.size() > top_) std::cout << GREY << "... " << ranked.size() - top_ << " more (--top)" << RESET << "\n";
+        std::cout << "\n";
+    }
+
+    // An include is redundant when another include of the same file already
+    // brings the header in.
+    void reportRedundant() {
+        std::vector<std::string> findings;
+        for (const auto& [file, included] : includes_) {
+            if (!isProjectFile(file)) continue;
+            for (const auto& header : included) {
+                for (const auto& other : included) {
+                    if (other == header || !reachable(other).count(header)) continue;
+                    findings.push_back(file + ": " + header + " also comes in through " + other);
+                    break;
+                }
+            }
+        }
+        printFindings("🔁 Redundant includes", findings,
+                      "Dropping one only helps while the other include stays; keep those the file uses directly.");
+    }
+
+    // An include looks unused when the file names nothing that the header,
+    // or anything the header includes, declares.
+    void reportUnused() {
+        std::vector<std::string> findings;
+        for (const auto& [file, included] : includes_) {
+            if (!isProjectFile(file)) continue;
+            const auto& used = names(file).used;
+            for (const auto& header : included) {
+                bool any_declared = false;
+                bool is_used = false;
+                for (const auto& reached : reachable(header)) {
+                    for (const auto& name : names(reached).declared) {
+                        any_declared = true;
+                        if (used.count(name)) {
+                            is_used = true;
+                            break;
+                        }
+                    }
+                    if (is_used) break;
+                }
+                if (any_declared && !is_used) findings.push_back(file + ": " + header);
+            }
+        }
+        printFindings("🧹 Includes that look unused", findings,
+                      "Found by matching names, without compiling; check before removing.");
+    }
+
+    // Headers most units read, most expensive first, spelled as the sources
+    // include them. A header that mostly wraps another candidate, such as a
+    // project header around a vendored library, gives way to the one it
+    // wraps: that changes less often. Of the rest, a header another one
+    // includes is left out, since precompiling the other covers it.
+    void reportPch(const std::vector<const Header*>& ranked, const json& config) {
+        std::vector<const Header*> candidates;
+        size_t threshold = std::max<size_t>(2, (units_.size() + 1) / 2);
+        for (const Header* header : ranked) {
+            if (header->units.size() < threshold || !spellings_.count(header->path)) continue;
+            if (isModuleInterfaceFile(header->path)) continue;
+            if ((header->preprocessed ? header->preprocessed : header->size) < kMinPchSize) continue;
+            candidates.push_back(header);
+        }
+
+        auto includes = [this](const Header* outer, const Header* inner) {
+            return outer != inner && reachable(outer->path).count(inner->path) && !reachable(inner->path).count(outer->path);
+        };
+
+        std::vector<const Header*> substantial;
+        for (const Header* candidate : candidates) {
+            uintmax_t inner = 0;
+            for (const Header* other : candidates) {
+                if (includes(candidate, other)) inner = std::max(inner, other->preprocessed);
+            }
+            if (!candidate->preprocessed || inner < candidate->preprocessed * 9 / 10) substantial.push_back(candidate);
+        }
+
+        // Headers that cost next to nothing are not worth a PCH rebuild.
+        std::vector<const Header*> chosen;
+        for (const Header* candidate : substantial) {
+            bool covered = std::any_of(substantial.begin(), substantial.end(), [&](const Header* other) {
+                return includes(other, candidate);
+            });
+            if (!covered && candidate->cost() >= substantial.front()->cost() / 100) chosen.push_back(candidate);
+        }
+
+        std::cout << "📦 Precompiled header candidates (read by at least half of the units, " << formatBytes(kMinPchSize)
+                  << " or more once preprocessed):\n";
+        if (chosen.empty()) {
+            std::cout << GREY << "  none" << RESET << "\n";
+            return;
+        }
+
+        std::vector<std::string> pch;
+        double total = 0;
+        for (const Header* header : chosen) {
+            if (pch.size() >= top_) break;
+            // The most common spelling that is not relative to the includer.
+            std::map<std::string, size_t> counts;
+            for (const auto& spelled : spellings_[header->path]) {
+                if (spelled.rfind(".", 0) != 0) ++counts[spelled];
+            }
+            if (counts.empty()) continue;
+            auto best = std::max_element(counts.begin(), counts.end(), [](const auto& a, const auto& b) {
+                return a.second < b.second;
+            });
+            pch.push_back(best->first);
+            total += header->cost();
+            std::cout << "  " << std::left << std::setw(40) << best->first << std::right << " "
+                      << header->units.size() << "/" << units_.size() << " units, " << formatBytes(header->cost())
+                      << (isProjectFile(header->path) && !isVendored(header->path) ? "  (project header: each change rebuilds the PCH)" : "")
+                      << "\n";
+        }
+        if (pch.empty()) return;
+        std::cout << "Precompiling them saves parsing up to " << formatBytes(total) << " per build:\n"
+                  << "  \"pch\": " << json(pch).dump() << "\n";
+        if (config.contains("pch")) {
+            std::cout << GREY << "cppkg.json has \"pch\": " << config["pch"].dump() << RESET << "\n";
+        }
+    }
+
+    void printFindings(const std::string& title, const std::vector<std::string>& findings, const std::string& note) {
+        std::cout << title << " (" << findings.size() << "):\n";
+        for (size_t i = 0; i < findings.size() && i < top_; ++i) {
+            std::cout << "  " << findings[i] << "\n";
+        }
+        if (findings.size() > top_) std::cout << GREY << "  ... " << findings.size() - top_ << " more" << RESET << "\n";
+        if (!findings.empty()) std::cout << GREY << note << RESET << "\n";
+        std::cout << "\n";
+    }
+};
+
+#endif
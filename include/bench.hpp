@@ -0,0 +1,358 @@
+#ifndef QUICK_CPPKG_BENCH_HPP
+#define QUICK_CPPKG_BENCH_HPP
+
+#define RESET   "\033[0m"
+#define RED     "\033[31m"
+#define GREEN   "\033[32m"
+#define YELLOW  "\033[33m"
+#define GREY    "\033[90m"
+
+#include "nlohmann/json.hpp"
+#include "process.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+    #include <linux/perf_event.h>
+    #include <sched.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+struct BenchOptions {
+    size_t runs = 0;           // measured runs; 0 = no benchmark, just run once
+    size_t warmup = 1;         // runs before measuring, to warm caches and the page cache
+    std::vector<int> cpus;     // pin the program to these CPUs; empty = anywhere
+    bool counters = false;     // read cycles, instructions and cache misses
+    std::string baseline;      // baseline JSON; "" = <build dir>/bench/<target>.json
+    bool save_baseline = false;
+    double threshold = 5;      // percent a median may worsen before it counts as a regression
+};
+
+// Summary of one metric over the measured runs.
+struct BenchStats {
+    double median = 0;
+    double p95 = 0;
+    double mean = 0;
+    double stddev = 0;
+    double min = 0;
+
+    // Nearest-rank percentiles; the sample standard deviation.
+    static BenchStats of(std::vector<double> values) {
+        BenchStats stats;
+        if (values.empty()) return stats;
+        std::sort(values.begin(), values.end());
+        size_t n = values.size();
+        stats.median = n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+        stats.p95 = values[static_cast<size_t>(std::ceil(0.95 * n)) - 1];
+        stats.min = values.front();
+        for (double value : values) stats.mean += value;
+        stats.mean /= n;
+        if (n > 1) {
+            double squares = 0;
+            for (double value : values) squares += (value - stats.mean) * (value - stats.mean);
+            stats.stddev = std::sqrt(squares / (n - 1));
+        }
+        return stats;
+    }
+
+    json toJson() const {
+        return {{"median", median}, {"p95", p95}, {"mean", mean}, {"stddev", stddev}, {"min", min}};
+    }
+};
+
+// Hardware counters of the programs we start. They are opened on the
+// calling thread with `inherit`, so children spawned from it while they are
+// enabled are counted, their counts folding in when they exit. Only user
+// space is counted, which perf_event_paranoid=2 still allows.
+class PerfCounters {
+public:
+    PerfCounters() = default;
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+    ~PerfCounters() { close(); }
+
+    // Returns "" on success, else why the counters are unavailable.
+    std::string open() {
+#ifdef __linux__
+        const std::pair<const char*, uint64_t> events[] = {
+            {"cycles", PERF_COUNT_HW_CPU_CYCLES},
+            {"instructions", PERF_COUNT_HW_INSTRUCTIONS},
+            {"cache_misses", PERF_COUNT_HW_CACHE_MISSES},
+        };
+        for (const auto& [name, config] : events) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = config;
+            attr.disabled = 1;
+            attr.inherit = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+            if (fd < 0) {
+                std::string reason = std::string(name) + ": " + std::strerror(errno);
+                close();
+                return reason;
+            }
+            counters_.push_back({name, static_cast<int>(fd)});
+        }
+        return "";
+#else
+        return "hardware counters need Linux perf events";
+#endif
+    }
+
+    bool enabled() const { return !counters_.empty(); }
+
+    void start() {
+#ifdef __linux__
+        for (const auto& counter : counters_) {
+            ioctl(counter.fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(counter.fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    std::map<std::string, double> stop() {
+        std::map<std::string, double> values;
+#ifdef __linux__
+        for (const auto& counter : counters_) {
+            ioctl(counter.fd, PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t value = 0;
+            if (read(counter.fd, &value, sizeof(value)) == sizeof(value)) values[counter.name] = static_cast<double>(value);
+        }
+#endif
+        return values;
+    }
+
+private:
+    struct Counter {
+        std::string name;
+        int fd;
+    };
+    std::vector<Counter> counters_;
+
+    void close() {
+#ifdef __linux__
+        for (const auto& counter : counters_) ::close(counter.fd);
+#endif
+        counters_.clear();
+    }
+};
+
+// Restricts the calling thread, and so the programs it starts, to a set of
+// CPUs until destroyed.
+class CpuPin {
+public:
+    explicit CpuPin(const std::vector<int>& cpus) {
+        if (cpus.empty()) return;
+#ifdef __linux__
+        CPU_ZERO(&saved_);
+        if (sched_getaffinity(0, sizeof(saved_), &saved_) != 0) {
+            throw std::runtime_error(std::string("Cannot read the CPU affinity: ") + std::strerror(errno));
+        }
+        cpu_set_t wanted;
+        CPU_ZERO(&wanted);
+        for (int cpu : cpus) {
+            if (cpu < 0 || cpu >= CPU_SETSIZE) throw std::runtime_error("No CPU " + std::to_string(cpu));
+            CPU_SET(cpu, &wanted);
+        }
+        if (sched_setaffinity(0, sizeof(wanted), &wanted) != 0) {
+            throw std::runtime_error(std::string("Cannot pin to the requested CPUs: ") + std::strerror(errno));
+        }
+        pinned_ = true;
+#else
+        throw std::runtime_error("--pin is only supported on Linux");
+#endif
+    }
+
+    CpuPin(const CpuPin&) = delete;
+    CpuPin& operator=(const CpuPin&) = delete;
+
+    ~CpuPin() {
+#ifdef __linux__
+        if (pinned_) sched_setaffinity(0, sizeof(saved_), &saved_);
+#endif
+    }
+
+private:
+    bool pinned_ = false;
+#ifdef __linux__
+    cpu_set_t saved_;
+#endif
+};
+
+// `cppkg run --bench`: runs a program after some warmup runs, summarises
+// wall, user and system time, peak RSS and optionally hardware counters,
+// and compares the medians with a stored baseline. A baseline is saved on
+// the first run and when asked to; afterwards a median that got worse by
+// more than the threshold fails the run.
+class Benchmark {
+public:
+    explicit Benchmark(BenchOptions options) : options_(std::move(options)) {}
+
+    // Throws if the program fails or a metric regressed.
+    void run(const std::string& program, const std::string& baseline_path) {
+        PerfCounters counters;
+        if (options_.counters) {
+            std::string error = counters.open();
+            if (!error.empty()) {
+                std::cerr << YELLOW << "⚠️  Hardware counters unavailable (" << error << "), measuring without them"
+                          << RESET << std::endl;
+            }
+        }
+
+        std::cout << "⏱️  Benchmarking " << program << ": " << options_.warmup << " warmup + " << options_.runs << " run(s)";
+        if (!options_.cpus.empty()) {
+            std::cout << ", pinned to CPU";
+            for (size_t i = 0; i < options_.cpus.size(); ++i) std::cout << (i ? "," : " ") << options_.cpus[i];
+        }
+        std::cout << std::endl;
+
+        std::map<std::string, std::vector<double>> samples;
+        {
+            CpuPin pin(options_.cpus);
+            for (size_t i = 0; i < options_.warmup + options_.runs; ++i) {
+                counters.start();
+                auto begin = std::chrono::steady_clock::now();
+                ProcessResult result = runProcess({program});
+                double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+                auto counts = counters.stop();
+
+                if (result.exit_code != 0) {
+                    std::cerr << result.output;
+                    throw std::runtime_error(program + " exited with code " + std::to_string(result.exit_code) +
+                                             " during the benchmark");
+                }
+                if (i < options_.warmup) continue;
+
+                samples["wall"].push_back(wall);
+                samples["user"].push_back(result.user_seconds);
+                samples["sys"].push_back(result.system_seconds);
+                samples["max_rss"].push_back(static_cast<double>(result.max_rss_kb));
+                for (const auto& [name, value] : counts) samples[name].push_back(value);
+            }
+        }
+
+        json metrics = json::object();
+        std::cout << std::left << std::setw(14) << "" << std::right;
+        for (const char* column : {"median", "p95", "mean", "stddev", "min"}) std::cout << std::setw(12) << column;
+        std::cout << "\n";
+        for (const char* name : kMetrics) {
+            if (!samples.count(name)) continue;
+            BenchStats stats = BenchStats::of(samples[name]);
+            metrics[name] = stats.toJson();
+            std::cout << std::left << std::setw(14) << name << std::right;
+            for (double value : {stats.median, stats.p95, stats.mean, stats.stddev, stats.min}) {
+                std::cout << std::setw(12) << format(name, value);
+            }
+            std::cout << "\n";
+        }
+        std::cout << std::flush;
+
+        json results = {{"version", 1}, {"program", program}, {"runs", options_.runs}, {"metrics", metrics}};
+        json baseline;
+        std::ifstream baseline_file(baseline_path);
+        if (baseline_file && !options_.save_baseline) {
+            try {
+                baseline = json::parse(baseline_file);
+            } catch (const json::parse_error& e) {
+                throw std::runtime_error("Cannot read baseline " + baseline_path + ": " + e.what());
+            }
+        }
+
+        if (baseline.is_null()) {
+            if (fs::path(baseline_path).has_parent_path()) fs::create_directories(fs::path(baseline_path).parent_path());
+            std::ofstream(baseline_path) << results.dump(2) << "\n";
+            std::cout << GREY << "📌 Saved baseline " << baseline_path << RESET << std::endl;
+            return;
+        }
+        compare(metrics, baseline.value("metrics", json::object()), baseline_path);
+    }
+
+private:
+    // In report order. sys time and cache misses are shown but too noisy
+    // for short programs to gate on.
+    static constexpr const char* kMetrics[] = {"wall", "user", "sys", "max_rss", "cycles", "instructions", "cache_misses"};
+
+    BenchOptions options_;
+
+    static bool gated(const std::string& metric) {
+        return metric != "sys" && metric != "cache_misses";
+    }
+
+    static std::string format(const std::string& metric, double value) {
+        std::ostringstream text;
+        text << std::fixed << std::setprecision(2);
+        if (metric == "wall" || metric == "user" || metric == "sys") {
+            if (value < 1) {
+                text << value * 1000 << " ms";
+            } else {
+                text << value << " s";
+            }
+        } else if (metric == "max_rss") {
+            text << value / 1024 << " MiB";
+        } else if (value >= 1e9) {
+            text << value / 1e9 << " G";
+        } else if (value >= 1e6) {
+            text << value / 1e6 << " M";
+        } else if (value >= 1e3) {
+            text << value / 1e3 << " k";
+        } else {
+            text << std::setprecision(0) << value;
+        }
+        return text.str();
+    }
+
+    void compare(const json& metrics, const json& baseline, const std::string& baseline_path) const {
+        std::cout << "Compared with " << baseline_path << " (medians):\n";
+        std::vector<std::string> regressions;
+        for (const char* name : kMetrics) {
+            if (!metrics.contains(name) || !baseline.contains(name)) continue;
+            double before = baseline[name].value("median", 0.0);
+            double now = metrics[name].value("median", 0.0);
+            if (before <= 0) continue;
+
+            double change = (now / before - 1) * 100;
+            bool regressed = gated(name) && change > options_.threshold;
+            if (regressed) regressions.push_back(name);
+
+            std::ostringstream line;
+            line << "  " << std::left << std::setw(14) << name << std::right << std::setw(12) << format(name, before)
+                 << " -> " << std::setw(12) << format(name, now) << "  " << std::showpos << std::fixed
+                 << std::setprecision(1) << change << "%";
+            const char* color = regressed ? RED : change < -options_.threshold ? GREEN : "";
+            std::cout << color << line.str() << (regressed ? "  regression" : "") << (*color ? RESET : "") << "\n";
+        }
+        std::cout << std::flush;
+
+        if (!regressions.empty()) {
+            std::ostringstream message;
+            message << "Benchmark regressed by more than " << options_.threshold << "% in ";
+            for (size_t i = 0; i < regressions.size(); ++i) message << (i ? ", " : "") << regressions[i];
+            message << "; rerun with --save-baseline to accept";
+            throw std::runtime_error(message.str());
+        }
+        std::cout << GREEN << "✅ No regressions beyond " << options_.threshold << "%" << RESET << std::endl;
+    }
+};
+
+#endif
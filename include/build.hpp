@@ -10,13 +10,42 @@
 #define CYAN    "\033[36m"
 #define GREY    "\033[90m"
 
+#include "cache.hpp"
 #include "command.hpp"
 #include "dependency.hpp"
+#include "depbuild.hpp"
+#include "depfile.hpp"
+#include "fetch.hpp"
+#include "hash.hpp"
+#include "includes.hpp"
+#include "lockfile.hpp"
+#include "modules.hpp"
+#include "ninja.hpp"
+#include "pch.hpp"
+#include "process.hpp"
+#include "profile.hpp"
+#include "remote.hpp"
+#include "scheduler.hpp"
+#include "state.hpp"
+#include "target.hpp"
+#include "toolchain.hpp"
+#include "trace.hpp"
+#include "unity.hpp"
+#include "watch.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
 #include <iostream>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
 #include <vector>
-#include <cstdlib>
 #include <unordered_map>
 #include "nlohmann/json.hpp"
 #include <unordered_set>
@@ -24,16 +53,130 @@
 namespace fs = std::filesystem;
 using json = nlohmann::json;
 
+struct CompileStep {
+    std::string source;
+    std::string object;
+    std::string depfile;
+    ModuleUnit module{};                // what the source declares and imports
+    std::string bmi{};                  // where the BMI of the module it provides goes
+    std::vector<std::string> imports{}; // every module it needs, including its imports' imports
+};
+
+struct BuildOptions {
+    size_t jobs = 0; // 0 = std::thread::hardware_concurrency()
+    bool use_cache = true;
+    size_t unity = 0; // sources per unity file, 0 = no unity build
+    std::string profile = "debug";
+    std::string pgo; // "generate", "use" or empty
+    bool trace = false;
+    bool watch = false;
+    std::string generator = "cppkg"; // "cppkg" (the built-in scheduler) or "ninja"
+    std::vector<std::string> sanitize; // address, undefined, thread, leak
+    bool coverage = false;
+    std::vector<std::string> workers; // `cppkg worker` addresses; $CPPKG_WORKERS when empty
+};
+
 class BuildHandler : public CommandHandler {
 public:
-    BuildHandler() : config_(json::parse(std::ifstream("cppkg.json"))){}
+    BuildHandler(const BuildOptions& options = {})
+        : config_(json::parse(std::ifstream("cppkg.json"))), options_(options), trace_(options.trace) {}
+
     void execute() override {
+        if (options_.watch) {
+            watch();
+            return;
+        }
+        bool ok = build();
+        if (trace_.enabled()) writeTrace();
+        if (!ok) throw std::runtime_error("Build failed");
+    }
+
+    // Builds, then rebuilds whenever a source, header, cppkg.json or
+    // cppkg.lock changes, until interrupted. The toolchain, dependencies and
+    // build state stay in memory between rounds, and only files reported by
+    // the watcher are looked at again, so a rebuild costs little more than
+    // the compiles it needs. `after_build` runs after every successful
+    // round and is told whether anything was relinked.
+    void watch(const std::function<void(bool relinked)>& after_build = {}) {
+        FileWatcher watcher(watchRoots(), {"cppkg.json", "cppkg.lock"});
+        while (true) {
+            bool ok = false;
+            try {
+                ok = build();
+                if (trace_.enabled()) writeTrace();
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+            }
+            if (ok && after_build) after_build(linked_ > 0);
+
+            std::cout << GREY << "👀 Watching for changes (Ctrl+C to stop)" << RESET << std::endl;
+            FileChanges changes = watcher.wait(kDebounce);
+            std::cout << GREY << "🔄 " << changes.paths.size() << " file(s) changed" << RESET << std::endl;
+            applyChanges(changes);
+        }
+    }
+
+    // A single build for commands that go on to use its outputs, such as
+    // `cppkg test`. Returns whether it succeeded.
+    bool buildOnce() {
+        bool ok = build();
+        if (trace_.enabled()) writeTrace();
+        return ok;
+    }
+
+    // A target of the last build: its binary and the shared libraries,
+    // the project's and its dependencies', that the binary loads.
+    struct Output {
+        Target target;
+        std::string binary;
+        std::vector<std::string> shared_libraries;
+    };
+
+    std::vector<Output> outputs() const {
+        std::vector<Output> outputs;
+        for (const auto& build : targets_) {
+            Output output{build.target, build.output, {}};
+            if (build.target.type != "static") {
+                for (const auto* library : linkedLibraries(build)) {
+                    if (library->target.type == "shared") output.shared_libraries.push_back(library->output);
+                }
+                for (const auto& dep : dependencies_) {
+                    if (dep.type == "shared" && !dep.library_path.empty()) {
+                        output.shared_libraries.push_back(dep.library_path);
+                    }
+                }
+            }
+            outputs.push_back(std::move(output));
+        }
+        return outputs;
+    }
+
+    const std::string& outputDirectory() const { return out_dir_; }
+
+private:
+    static constexpr const char* kTracePath = "build/cppkg-trace.json";
+    static constexpr std::chrono::milliseconds kDebounce{100};
+
+    // A target as planned for this build.
+    struct TargetBuild {
+        Target target;
+        std::string output;
+        std::vector<std::string> include_paths;
+        std::vector<std::string> compile_flags;
+        std::vector<std::string> pch_flags;
+        std::optional<CompileStep> pch;
+        std::vector<CompileStep> steps;
+        std::vector<std::string> objects;
+    };
+
+    // Returns whether the build succeeded.
+    bool build() {
         if (!fs::exists("_packages")) {
             try {
                 fs::create_directory("_packages");
             } catch (const fs::filesystem_error& e) {
                 std::cerr << "Error: " << e.what() << '\n';
-                return;
+                return false;
             }
         }
 
@@ -41,41 +184,839 @@ public:
 
         if (!checkProjectStructure()) {
             std::cerr << RED << "❌ Project structure is invalid. Missing required files/directories." << RESET << std::endl;
-            return;
+            return false;
+        }
+
+        if (!prepared_) prepare();
+
+        if (rescan_) {
+            auto span = trace_.span("scan tree");
+            tree_files_ = scanTree(".", state_);
+            rescan_ = false;
+        }
+
+        targets_ = planTargets();
+        include_paths_ = findHeaderDirectories();
+        linked_ = 0;
+        link_micros_ = 0;
+        auto plan_begin = BuildTrace::Clock::now();
+
+        for (auto& target : targets_) {
+            target.include_paths = targetIncludePaths(target);
+        }
+        if (!scanModules()) {
+            std::cerr << RED << "❌ Build failed" << RESET << std::endl;
+            return false;
+        }
+        for (auto& target : targets_) {
+            planCompiles(target);
         }
+        resolveModules();
+        writeCompileCommands();
+
+        if (options_.generator == "ninja") {
+            return generateNinja();
+        }
+
+        // Targets come in dependency order. Each target's link waits for its
+        // own objects and for the targets it links against; everything else
+        // runs concurrently.
+        // Workers add their slots to the local ones.
+        JobScheduler scheduler(remote_ ? localSlots() + remote_->slots() : options_.jobs);
+        size_t compiled = 0;
+        remote_compiles_ = 0;
+        remote_fallbacks_ = 0;
+        std::map<std::string, size_t> link_jobs;
+        std::map<std::string, size_t> module_jobs; // module -> job producing its BMI
 
-        std::string build_cmd = buildCompilationCommand();
+        for (auto& target : targets_) {
+            TargetBuild* current = &target;
 
-        std::cout << "🔧 Running build command:\n" << build_cmd << RESET << std::endl;
+            // Every object waits for the precompiled header and is rebuilt
+            // whenever the header is.
+            std::vector<size_t> after_pch;
+            if (target.pch) {
+                std::vector<std::string> pch_cmd = buildPchCommand(target, *target.pch);
+                std::string command_hash = hashCommand(pch_cmd, pgo_stamp_);
+                if (needsRebuild(*target.pch, command_hash)) {
+                    after_pch.push_back(scheduler.add([this, current, pch_cmd, command_hash]() {
+                        return precompileHeader(*current, pch_cmd, command_hash);
+                    }));
+                    ++compiled;
+                }
+            }
+
+            std::vector<size_t> link_after;
+            for (const auto& step : target.steps) {
+                std::vector<std::string> build_cmd = buildCompilationCommand(target, step);
+                std::string command_hash = hashCommand(build_cmd, pgo_stamp_);
+
+                // Importers wait for the BMIs they read and are rebuilt
+                // whenever one of them is.
+                std::vector<size_t> after = after_pch;
+                for (const auto& module : step.imports) {
+                    auto job = module_jobs.find(module);
+                    if (job != module_jobs.end()) after.push_back(job->second);
+                }
+
+                if (after.empty() && !needsRebuild(step, command_hash)) {
+                    continue;
+                }
+
+                // Does not change the object, so it stays out of the command hash.
+                bool time_trace = trace_.enabled() && compiler_ != "cl" && isClang();
+                if (time_trace) build_cmd.push_back("-ftime-trace");
+
+                fs::create_directories(fs::path(step.object).parent_path());
+
+                size_t job = scheduler.add([this, current, step, build_cmd, command_hash, time_trace]() {
+                    return compileSource(*current, step, build_cmd, command_hash, time_trace);
+                }, after);
+                if (!step.module.provides.empty()) module_jobs[step.module.provides] = job;
+                link_after.push_back(job);
+                ++compiled;
+            }
+
+            for (const auto& dep : target.target.deps) {
+                link_after.push_back(link_jobs.at(dep));
+            }
+            link_jobs[target.target.name] = scheduler.add([this, current]() {
+                return linkTarget(*current);
+            }, link_after);
+        }
 
-        int result = system(build_cmd.c_str());
-        if (result == 0) {
-            std::cout << GREEN << "✅ Build successful! Executable created in build/ directory" << RESET << std::endl;
+        if (compiled > 0) {
+            std::cout << "⚙️  Compiling " << compiled << " file(s) with "
+                      << std::min(scheduler.workers(), compiled) << " job(s)" << std::endl;
+        }
+
+        auto compile_begin = BuildTrace::Clock::now();
+        trace_.complete("plan", "phase", plan_begin, compile_begin);
+        workers_used_ = std::min(scheduler.workers(), compiled + targets_.size());
+        bool ok = scheduler.run();
+        trace_.complete("compile and link", "phase", compile_begin, BuildTrace::Clock::now(), 0, {
+            {"steps", compiled},
+            {"targets", targets_.size()},
+            {"workers", workers_used_},
+            {"cache_hits", cache_ ? cache_->hits() : 0},
+            {"cache_misses", cache_ ? cache_->misses() : 0}
+        });
+        saveState();
+
+        if (cache_ && compiled > 0) {
+            std::cout << GREY << "📦 Cache: " << cache_->hits() << " hit(s), "
+                      << cache_->misses() << " miss(es)" << RESET << std::endl;
+            cache_->flush();
+        }
+
+        if (remote_compiles_ > 0 || remote_fallbacks_ > 0) {
+            std::cout << GREY << "🌐 Remote: " << remote_compiles_ << " compiled on workers, " << remote_fallbacks_
+                      << " compiled here after a worker was busy or failed" << RESET << std::endl;
+        }
+
+        if (!ok) {
+            std::cerr << RED << "❌ Build failed" << RESET << std::endl;
+            return false;
+        }
+
+        if (linked_ > 0) {
+            std::cout << GREY << "🔗 Linked " << linked_ << " target(s) in " << std::fixed << std::setprecision(2)
+                      << link_micros_ / 1e6 << " s" << (linker_.empty() ? "" : " with " + linker_) << RESET << std::endl;
+        }
+
+        if (compiled == 0 && linked_ == 0) {
+            std::cout << GREEN << "✅ Build is up to date" << RESET << std::endl;
+            return true;
+        }
+
+        std::cout << GREEN << "✅ Build successful! Outputs created in " << out_dir_ << "/ directory" << RESET << std::endl;
+        if (options_.coverage) {
+            std::cout << YELLOW << "📊 Coverage data is written when the program runs: " << (isClang()
+                ? "raw profiles go to " + out_dir_ + "/coverage/ via `cppkg run --coverage`, for llvm-profdata and llvm-cov"
+                : ".gcda files next to the objects in " + out_dir_ + "/obj/, for gcov, gcovr or lcov") << RESET << std::endl;
+        }
+        if (options_.pgo == "generate") {
+            std::cout << YELLOW << "📈 Run a representative workload with `cppkg run --profile " << profile_.name
+                      << "`, then rebuild with --pgo-use" << RESET << std::endl;
+        }
+        return true;
+    }
+
+    // Works out how each translation unit of `target` is compiled: its
+    // flags, precompiled header and (in unity builds) generated sources.
+    void planCompiles(TargetBuild& target) {
+        target.compile_flags = compileFlags(target);
+        target.pch = preparePch(target);
+
+        const auto& sources = target.target.sources;
+        std::vector<std::string> units = options_.unity ? unityUnits(target) : sources;
+        for (const auto& source : units) {
+            target.steps.push_back(makeCompileStep(target, source));
+            target.objects.push_back(target.steps.back().object);
+        }
+    }
+
+    // Finds the sources that declare or import modules (C++20 and later
+    // only). Results are kept in build/<profile>/modules.json and reused
+    // while a source's mtime and size stay the same, so a build only scans
+    // the files edited since the last one.
+    bool scanModules() {
+        module_units_.clear();
+        modules_used_ = false;
+        if (!standardHasModules(config_["cpp_version"].get<std::string>())) return true;
+
+        const std::string scanner = moduleScanner();
+        const std::string cache_path = out_dir_ + "/modules.json";
+        json cache;
+        if (std::ifstream file(cache_path); file) {
+            try {
+                cache = json::parse(file);
+            } catch (const json::parse_error&) {}
+        }
+        if (!cache.is_object() || cache.value("scanner", "") != scanner || !cache["sources"].is_object()) {
+            cache = {{"scanner", scanner}, {"sources", json::object()}};
+        }
+
+        std::map<std::string, ModuleUnit> units;
+        std::map<std::string, json> stamps;
+        size_t scanned = 0;
+        std::mutex mutex;
+        JobScheduler scheduler(options_.jobs);
+        for (const auto& target : targets_) {
+            for (const auto& source : target.target.sources) {
+                std::string path = fs::path(source).lexically_normal().generic_string();
+                if (stamps.count(path)) continue;
+                FileInfo info = statFile(source);
+                stamps[path] = {{"mtime", info.mtime}, {"size", info.size}};
+
+                const json& cached = cache["sources"].contains(path) ? cache["sources"][path] : json();
+                if (cached.is_object() && cached.value("stamp", json()) == stamps[path]) {
+                    units[path] = ModuleUnit::fromJson(cached);
+                    continue;
+                }
+                const TargetBuild* current = &target;
+                ++scanned;
+                scheduler.add([this, current, source, path, scanner, &units, &mutex]() {
+                    JobResult job;
+                    ModuleUnit unit = scanUnit(*current, source, scanner, job);
+                    if (!job.ok) return job;
+                    std::lock_guard<std::mutex> lock(mutex);
+                    units[path] = std::move(unit);
+                    return job;
+                });
+            }
+        }
+
+        if (scanned > 0) {
+            auto span = trace_.span("scan modules");
+            if (!scheduler.run()) return false;
+            std::cout << GREY << "🔎 Scanned " << scanned << " source(s) for modules" << RESET << std::endl;
+        }
+
+        json sources = json::object();
+        for (const auto& [path, unit] : units) {
+            json entry = unit.toJson();
+            entry["stamp"] = stamps[path];
+            sources[path] = std::move(entry);
+            if (!unit.empty()) {
+                module_units_[path] = unit;
+                modules_used_ = true;
+            }
+        }
+        writeIfChanged(cache_path, json{{"scanner", scanner}, {"sources", sources}}.dump(2) + "\n");
+        return true;
+    }
+
+    // "lexical" for scanModuleSource alone, or the compiler's own P1689
+    // scanner when there is one: "cl" (/scanDependencies), "gcc" (g++ 14's
+    // -fdeps-format) or the path of clang-scan-deps.
+    std::string moduleScanner() const {
+        if (compiler_ == "cl") return "cl";
+        if (isClang()) {
+            fs::path sibling = fs::path(toolchain_.path).parent_path() / "clang-scan-deps";
+            auto found = findInPath(fs::exists(sibling) ? sibling.string() : "clang-scan-deps");
+            return found ? found->string() : "lexical";
+        }
+        return toolchain_.majorVersion() >= 14 ? "gcc" : "lexical";
+    }
+
+    // Only sources the lexical scan finds module syntax in (and module
+    // interface files) are handed to the compiler's scanner, so plain
+    // sources never cost a process. Should that scanner fail, the lexical
+    // result is used and the compile reports the actual error; `job` only
+    // fails when the scan's own files cannot be set up.
+    ModuleUnit scanUnit(const TargetBuild& build, const std::string& source, const std::string& scanner,
+                        JobResult& job) {
+        ModuleUnit lexical = scanModuleSource(source);
+        if (scanner == "lexical" || (lexical.empty() && !isModuleInterfaceFile(source))) return lexical;
+
+        CompileStep step = makeCompileStep(build, source);
+        step.module = lexical;
+        std::string ddi = step.object.substr(0, step.object.size() - 2) + ".ddi";
+        std::error_code ec;
+        fs::create_directories(fs::path(ddi).parent_path(), ec);
+        if (!ec) fs::remove(ddi, ec);
+        if (ec) {
+            job.ok = false;
+            job.output = RED + std::string("❌ Cannot scan ") + source + " for modules: " + ec.message() + RESET + "\n";
+            return lexical;
+        }
+
+        std::vector<std::string> cmd;
+        std::vector<std::string> flags = compileFlags(build);
+        std::vector<std::string> language = languageFlags(step);
+        if (scanner == "cl") {
+            cmd = flags;
+            cmd.insert(cmd.end(), language.begin(), language.end());
+            cmd.insert(cmd.end(), {"/scanDependencies", ddi, source});
+        } else if (scanner == "gcc") {
+            cmd = flags;
+            cmd.push_back("-fmodules-ts");
+            cmd.insert(cmd.end(), language.begin(), language.end());
+            cmd.insert(cmd.end(), {"-E", source, "-o", ddi + ".i", "-MT", ddi, "-MD", "-MF", ddi + ".d",
+                                   "-fdeps-format=p1689r5", "-fdeps-file=" + ddi, "-fdeps-target=" + step.object});
         } else {
-            std::cerr << RED << "❌ Build failed with error code: " << result << RESET << std::endl;
+            cmd = {scanner, "-format=p1689", "--"};
+            cmd.insert(cmd.end(), flags.begin(), flags.end());
+            cmd.insert(cmd.end(), language.begin(), language.end());
+            cmd.insert(cmd.end(), {"-c", source, "-o", step.object});
+        }
+
+        ProcessResult result = runProcess(cmd);
+        json document;
+        if (result.exit_code == 0) {
+            try {
+                document = scanner == "cl" || scanner == "gcc" ? json::parse(std::ifstream(ddi)) : json::parse(result.output);
+            } catch (const json::parse_error&) {}
         }
+        if (!document.is_object()) {
+            job.output = GREY + std::string("ℹ️  Module scan of ") + source + " failed, using what it declares literally" + RESET + "\n";
+            return lexical;
+        }
+
+        // A module declaration cannot come from a macro, so the lexical
+        // scan has the right name.
+        ModuleUnit unit = parseP1689(document);
+        unit.name = lexical.name;
+        return unit;
     }
 
-private:
-    json config_;
+    // Connects importers to the units providing their modules: every step
+    // learns all the modules it needs, steps are ordered so that providers
+    // come before their importers, and g++ gets the mapper file naming each
+    // module's BMI. Modules form one namespace across targets, but a target
+    // may only import from itself and the libraries it links.
+    void resolveModules() {
+        modules_.clear();
+        module_keys_.clear();
+        if (!modules_used_) return;
 
-    std::vector<std::string> findHeaderDirectories() {
-        std::unordered_set<std::string> header_dirs;
+        std::map<std::string, std::string> providers; // module -> source
+        for (const auto& [source, unit] : module_units_) {
+            if (unit.provides.empty()) continue;
+            auto [it, inserted] = providers.insert({unit.provides, source});
+            if (!inserted) {
+                throw std::runtime_error(RED + std::string("❌ Module '") + unit.provides + "' is declared by both " +
+                                         it->second + " and " + source + RESET);
+            }
+        }
+
+        std::map<std::string, std::set<std::string>> needed; // module -> modules it needs
+        std::set<std::string> visiting;
+        std::function<const std::set<std::string>&(const std::string&, const std::string&)> needs =
+            [&](const std::string& module, const std::string& importer) -> const std::set<std::string>& {
+                auto done = needed.find(module);
+                if (done != needed.end()) return done->second;
+
+                auto provider = providers.find(module);
+                if (provider == providers.end()) {
+                    throw std::runtime_error(RED + std::string("❌ ") + importer + " imports module '" + module +
+                                             "', which no source of the project declares" + RESET);
+                }
+                if (!visiting.insert(module).second) {
+                    throw std::runtime_error(RED + std::string("❌ Module '") + module + "' is part of an import cycle" + RESET);
+                }
+                std::set<std::string> all;
+                for (const auto& import : module_units_.at(provider->second).imports) {
+                    all.insert(import);
+                    const auto& indirect = needs(import, provider->second);
+                    all.insert(indirect.begin(), indirect.end());
+                }
+                visiting.erase(module);
+                return needed[module] = std::move(all);
+            };
+
+        std::map<std::string, const TargetBuild*> owners; // module -> target
+        for (auto& target : targets_) {
+            for (auto& step : target.steps) {
+                std::set<std::string> all;
+                for (const auto& import : step.module.imports) {
+                    all.insert(import);
+                    const auto& indirect = needs(import, step.source);
+                    all.insert(indirect.begin(), indirect.end());
+                }
+                step.imports.assign(all.begin(), all.end());
+                if (!step.module.provides.empty()) owners[step.module.provides] = &target;
+            }
+            // A module needs more modules than any module it imports.
+            std::stable_sort(target.steps.begin(), target.steps.end(), [](const CompileStep& a, const CompileStep& b) {
+                return a.imports.size() < b.imports.size();
+            });
+        }
+
+        for (const auto& target : targets_) {
+            std::set<std::string> reachable = {target.target.name};
+            for (const auto* library : linkedLibraries(target)) {
+                reachable.insert(library->target.name);
+            }
+            for (const auto& step : target.steps) {
+                if (!step.module.provides.empty()) modules_[step.module.provides] = {&target, step};
+                for (const auto& module : step.imports) {
+                    const TargetBuild* owner = owners.at(module);
+                    if (!reachable.count(owner->target.name)) {
+                        throw std::runtime_error(RED + std::string("❌ Target '") + target.target.name + "' imports module '" +
+                                                 module + "' of target '" + owner->target.name +
+                                                 "', which it does not depend on" + RESET);
+                    }
+                }
+            }
+        }
+
+        fs::create_directories(out_dir_ + "/bmi");
+        if (compiler_ != "cl" && !isClang()) {
+            std::string mapper;
+            for (const auto& [module, provider] : modules_) {
+                mapper += module + " " + provider.step.bmi + "\n";
+            }
+            writeIfChanged(moduleMapperPath(), mapper);
+        }
+    }
+
+    std::string bmiPath(const std::string& module) const {
+        std::string extension = compiler_ == "cl" ? ".ifc" : isClang() ? ".pcm" : ".gcm";
+        return out_dir_ + "/bmi/" + bmiFileName(module, extension);
+    }
+
+    std::string moduleMapperPath() const {
+        return out_dir_ + "/modules.map";
+    }
+
+    // build/compile_commands.json, where clangd and clang-tidy look for it.
+    // Every source gets the command it would be compiled with on its own,
+    // even in unity builds, and without the precompiled header, which other
+    // tools cannot read. Rewritten only when it changes, so indexers do not
+    // start over after every build.
+    void writeCompileCommands() {
+        std::string directory = fs::current_path().string();
+        json commands = json::array();
+        for (auto& target : targets_) {
+            TargetBuild standalone = target;
+            standalone.pch_flags.clear();
+            for (const auto& source : target.target.sources) {
+                CompileStep step = makeCompileStep(target, source);
+                commands.push_back({
+                    {"directory", directory},
+                    {"file", fs::path(source).lexically_normal().generic_string()},
+                    {"arguments", buildCompilationCommand(standalone, step)},
+                    {"output", step.object}
+                });
+            }
+        }
+        writeIfChanged("build/compile_commands.json", commands.dump(2) + "\n");
+    }
+
+    // --generator ninja: writes build/<profile>/build.ninja from the same
+    // plan the built-in scheduler would run, then hands it to ninja when it
+    // is installed. Commands are baked into each build statement, so ninja
+    // rebuilds exactly when cppkg's own command hashes would change.
+    bool generateNinja() {
+        const std::string path = out_dir_ + "/build.ninja";
+        const bool msvc = compiler_ == "cl";
 
-        const std::unordered_set<std::string> header_extensions = { ".h", ".hpp", ".hh", ".hxx" };
+        NinjaWriter ninja;
+        ninja.comment("Generated by `cppkg build --generator ninja --profile " + profile_.name + "`; do not edit.");
+        ninja.variable("ninja_required_version", modules_.empty() ? "1.3" : "1.7");
+        ninja.variable("builddir", out_dir_);
+        ninja.newline();
 
-        for (const auto& entry : fs::recursive_directory_iterator(".")) {
-            if (entry.is_regular_file()) {
-                std::string ext = entry.path().extension().string();
+        NinjaWriter::Variables compile = {{"command", "$cmd"}, {"description", "CXX $in"}};
+        if (!msvc) compile.insert(compile.end(), {{"depfile", "$depfile"}, {"deps", "gcc"}});
+        ninja.rule("cxx", compile);
+        #ifdef _WIN32
+            ninja.rule("archive", {{"command", "$cmd"}, {"description", "AR $out"}});
+        #else
+            // ar adds to an existing archive rather than replacing it.
+            ninja.rule("archive", {{"command", "rm -f $out && $cmd"}, {"description", "AR $out"}});
+        #endif
+        ninja.rule("link", {{"command", "$cmd"}, {"description", "LINK $out"}});
+
+        std::vector<std::string> outputs;
+        for (const auto& target : targets_) {
+            std::vector<std::string> after_pch;
+            if (target.pch) {
+                ninja.build({target.pch->object}, "cxx", {target.pch->source}, {}, {
+                    {"cmd", formatCommand(buildPchCommand(target, *target.pch))},
+                    {"depfile", target.pch->depfile}
+                });
+                after_pch.push_back(target.pch->object);
+            }
+
+            for (const auto& step : target.steps) {
+                NinjaWriter::Variables variables = {{"cmd", formatCommand(buildCompilationCommand(target, step))}};
+                if (!msvc) variables.push_back({"depfile", step.depfile});
+                std::vector<std::string> implicit = step.module.name.empty() ? after_pch : std::vector<std::string>{};
+                for (const auto& module : step.imports) {
+                    implicit.push_back(modules_.at(module).step.bmi);
+                }
+                std::vector<std::string> bmi;
+                if (!step.bmi.empty()) bmi.push_back(step.bmi);
+                ninja.build({step.object}, "cxx", {step.source}, implicit, variables, bmi);
+            }
 
-                if (header_extensions.count(ext)) {
-                    std::string dir = entry.path().parent_path().string();
-                    header_dirs.insert(dir);
+            std::vector<std::string> libraries;
+            if (target.target.type != "static") {
+                for (const auto& input : linkInputs(target)) {
+                    if (std::find(target.objects.begin(), target.objects.end(), input) == target.objects.end()) {
+                        libraries.push_back(input);
+                    }
                 }
             }
+            ninja.build({target.output}, target.target.type == "static" ? "archive" : "link", target.objects, libraries, {
+                {"cmd", formatCommand(buildLinkCommand(target))}
+            });
+            ninja.newline();
+            outputs.push_back(target.output);
+        }
+        ninja.defaults(outputs);
+
+        writeIfChanged(path, ninja.str());
+        std::cout << "📝 Wrote " << path << std::endl;
+
+        if (!findInPath("ninja")) {
+            throw std::runtime_error("ninja is not installed; build with `ninja -f " + path + "` once it is");
         }
 
-        return {header_dirs.begin(), header_dirs.end()};
+        std::vector<std::string> cmd = {"ninja", "-f", path};
+        if (options_.jobs > 0) cmd.insert(cmd.end(), {"-j", std::to_string(options_.jobs)});
+        std::cout << GREY << formatCommand(cmd) << RESET << std::endl;
+
+        ProcessOptions process;
+        process.capture = false;
+        if (runProcess(cmd, process).exit_code != 0) {
+            std::cerr << RED << "❌ Build failed" << RESET << std::endl;
+            return false;
+        }
+        std::cout << GREEN << "✅ Build successful! Outputs created in " << out_dir_ << "/ directory" << RESET << std::endl;
+        return true;
+    }
+
+    // Everything that only changes with cppkg.json or cppkg.lock: the
+    // toolchain, the profile, the build state and the dependencies. Watch
+    // mode keeps it between rounds.
+    void prepare() {
+        compiler_ = findCompiler();
+        if (compiler_.empty()) {
+            throw std::runtime_error(getCompilerInstallInstructions());
+        }
+
+        auto cpp_version = config_["cpp_version"].get<std::string>();
+        if (cpp_version.rfind("c++", 0) == 0 && !toolchain_.supportsStd(cpp_version)) {
+            throw std::runtime_error(RED + std::string("❌ ") + compiler_ + " does not support -std=" + cpp_version + RESET);
+        }
+
+        profile_ = ProfileResolver(config_, compiler_ == "cl").resolve(options_.profile);
+        checkInstrumentation();
+        out_dir_ = "build/" + variantDirectory(profile_.name, options_.sanitize, options_.coverage);
+        fs::create_directories(out_dir_);
+        preparePgo();
+        linker_ = selectLinker();
+        std::cout << "🎯 Profile: " << profile_.name
+                  << (profile_.lto.empty() ? "" : ", " + profile_.lto + " LTO")
+                  << (options_.pgo.empty() ? "" : ", PGO " + options_.pgo)
+                  << (profile_.split_dwarf ? ", split DWARF" : "")
+                  << (options_.sanitize.empty() ? "" : ", sanitize=" + sanitizerList())
+                  << (options_.coverage ? ", coverage" : "")
+                  << (linker_.empty() ? "" : ", " + linker_ + " linker") << std::endl;
+
+        state_.load(statePath());
+        {
+            auto span = trace_.span("dependencies");
+            dependencies_ = getDependencies();
+        }
+
+        // MSVC has no -E/-MMD equivalent wired up here, so it is never cached.
+        // Neither are PGO builds: their objects depend on profile data that
+        // the preprocessed source does not show. Split-DWARF objects are
+        // incomplete without the .dwo files the cache does not keep, and
+        // coverage objects without their .gcno notes.
+        cache_.reset();
+        if (options_.use_cache && compiler_ != "cl" && options_.pgo.empty() && !profile_.split_dwarf &&
+            !options_.coverage) {
+            cache_ = std::make_unique<CompileCache>();
+        }
+
+        remote_.reset();
+        std::vector<std::string> workers = options_.workers.empty() ? workersFromEnvironment() : options_.workers;
+        if (!workers.empty() && compiler_ != "cl") {
+            remote_ = std::make_unique<RemoteWorkers>(workers, toolchain_.identity(), localSlots());
+            remote_->connect();
+            if (remote_->slots() == 0) {
+                remote_.reset();
+            } else {
+                std::cout << "🌐 Remote: " << remote_->reachable() << " worker(s) with " << remote_->slots()
+                          << " slot(s)" << std::endl;
+            }
+        }
+
+        prepared_ = true;
+        rescan_ = true;
+    }
+
+    // Forgets what is known about the changed files; everything else the
+    // previous round learnt stays valid.
+    void applyChanges(const FileChanges& changes) {
+        if (changes.overflow || changes.paths.count("cppkg.json") || changes.paths.count("cppkg.lock")) {
+            config_ = json::parse(std::ifstream("cppkg.json"));
+            prepared_ = false;
+        }
+        rescan_ = rescan_ || changes.structure || changes.overflow;
+
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        if (changes.overflow) {
+            file_info_.clear();
+            file_hashes_.clear();
+            return;
+        }
+        auto changed = [&](const std::string& path) {
+            return changes.paths.count(fs::path(path).lexically_normal().generic_string()) > 0;
+        };
+        for (auto it = file_info_.begin(); it != file_info_.end();) {
+            it = changed(it->first) ? file_info_.erase(it) : std::next(it);
+        }
+        for (auto it = file_hashes_.begin(); it != file_hashes_.end();) {
+            it = changed(it->first) ? file_hashes_.erase(it) : std::next(it);
+        }
+    }
+
+    // The directories watch mode follows: src/ and include/, plus whatever
+    // cppkg.json declares sources or headers in. A project keeping neither
+    // has its whole tree watched.
+    std::vector<std::string> watchRoots() const {
+        std::set<std::string> roots;
+        auto add = [&](const std::string& path) {
+            fs::path normalized = fs::path(path).lexically_normal();
+            if (!fs::is_directory(normalized)) normalized = normalized.parent_path();
+            std::string root = normalized.generic_string();
+            if (!root.empty() && root != "." && fs::is_directory(root)) roots.insert(root);
+        };
+
+        add("src");
+        add("include");
+        for (const auto& dir : declaredIncludeDirs(config_).all()) add(dir);
+        if (config_.contains("targets")) {
+            for (const auto& [name, target] : config_["targets"].items()) {
+                for (const auto& source : target.value("sources", std::vector<std::string>{})) add(source);
+                if (target.contains("include_dirs")) {
+                    for (const auto& dir : IncludeDirs::parse(target["include_dirs"]).all()) add(dir);
+                }
+            }
+        }
+        if (roots.empty()) return {"."};
+        return {roots.begin(), roots.end()};
+    }
+
+    JobResult precompileHeader(const TargetBuild& target, const std::vector<std::string>& pch_cmd,
+                               const std::string& command_hash) {
+        auto begin = BuildTrace::Clock::now();
+        const CompileStep& step = *target.pch;
+        forget(step.object);
+        JobResult job;
+        job.output = CYAN + std::string("🧩 Precompiling ") + step.source + RESET + "\n" +
+                     GREY + formatCommand(pch_cmd) + RESET + "\n";
+
+        ProcessResult result = runProcess(pch_cmd);
+        job.output += result.output;
+        if (result.exit_code != 0) {
+            job.ok = false;
+            job.output += RED + std::string("❌ Precompiled header failed: ") + step.source + RESET + "\n";
+        } else {
+            recordStep(step, command_hash);
+        }
+        trace_.complete(step.source, "compile", begin, BuildTrace::Clock::now(),
+                        JobScheduler::currentWorker(), {{"pch", true}});
+        return job;
+    }
+
+    JobResult compileSource(const TargetBuild& target, const CompileStep& step, const std::vector<std::string>& build_cmd,
+                            const std::string& command_hash, bool time_trace) {
+        auto begin = BuildTrace::Clock::now();
+        size_t worker = JobScheduler::currentWorker();
+        forget(step.object);
+        if (!step.bmi.empty()) forget(step.bmi);
+        JobResult job;
+
+        // Remote compiles start from the preprocessed source, which also
+        // gives the cache key and the depfile.
+        std::string preprocessed;
+        bool remote = remote_ && canCompileRemotely(target, time_trace) && preprocess(target, step, preprocessed);
+        std::string key;
+        if (cache_) key = remote ? cacheKey(target, step, preprocessed) : cacheKey(target, step);
+        if (!key.empty() && cache_->fetch(key, step.object, step.depfile, step.bmi)) {
+            job.output = CYAN + std::string("♻️  Cached ") + step.source + RESET + "\n";
+            recordStep(step, command_hash);
+            trace_.complete(step.source, "compile", begin, BuildTrace::Clock::now(), worker, {{"cached", true}});
+            return job;
+        }
+
+        // The object may be a hard link into the cache; never let the
+        // compiler overwrite it in place. Neither the BMI.
+        std::error_code ec;
+        fs::remove(step.object, ec);
+        if (!step.bmi.empty()) fs::remove(step.bmi, ec);
+
+        // A worker that is busy or gone hands the compile back to us.
+        ProcessResult result;
+        std::string where;
+        int slot = remote_ ? remote_->acquire(remote) : -1;
+        if (slot >= 0) {
+            auto compiled = remote_->compile(slot, remoteArgs(target), step.source, preprocessed);
+            remote_->release(slot);
+            if (compiled) {
+                where = remote_->name(slot);
+                result.exit_code = compiled->exit_code;
+                result.output = compiled->output;
+                if (result.exit_code == 0 && !writeObject(step.object, compiled->object)) {
+                    result.exit_code = 1;
+                    result.output += "cannot write " + step.object + "\n";
+                }
+                ++remote_compiles_;
+            } else {
+                slot = remote_->acquire(false);
+                ++remote_fallbacks_;
+            }
+        }
+        if (where.empty()) {
+            result = runProcess(build_cmd);
+            if (remote_) remote_->release(slot);
+        }
+
+        job.output = CYAN + std::string("🔧 Compiling ") + step.source + (where.empty() ? "" : " on " + where) + RESET + "\n" +
+                     GREY + formatCommand(build_cmd) + RESET + "\n" + result.output;
+        if (result.exit_code != 0) {
+            job.ok = false;
+            job.output += RED + std::string("❌ Compilation failed: ") + step.source + RESET + "\n";
+        } else {
+            if (!key.empty()) cache_->store(key, step.object, step.depfile, step.bmi);
+            recordStep(step, command_hash);
+        }
+
+        trace_.complete(step.source, "compile", begin, BuildTrace::Clock::now(), worker,
+                        {{"cached", false}, {"ok", job.ok}, {"worker", where.empty() ? "local" : where}});
+        if (time_trace) {
+            // clang names it after the object: foo.cpp.o -> foo.cpp.json
+            std::string stem = step.object.substr(0, step.object.size() - 2);
+            trace_.mergeClangTrace(stem + ".json", begin, worker);
+        }
+        return job;
+    }
+
+    // Runs once the target's objects and the libraries it uses are final,
+    // so the decision to relink sees their current content.
+    JobResult linkTarget(const TargetBuild& target) {
+        JobResult job;
+        std::vector<std::string> link_cmd = buildLinkCommand(target);
+        std::string command_hash = hashCommand(link_cmd, pgo_stamp_);
+        std::vector<std::string> inputs = linkInputs(target);
+        if (!needsLink(target.output, command_hash)) return job;
+
+        auto begin = BuildTrace::Clock::now();
+        forget(target.output);
+        job.output = "🔗 Linking " + target.output + ":\n" + formatCommand(link_cmd) + RESET + "\n";
+
+        // ar adds to an existing archive rather than replacing it.
+        std::error_code ec;
+        if (target.target.type == "static") fs::remove(target.output, ec);
+
+        ProcessResult result = runProcess(link_cmd);
+        job.output += result.output;
+        if (result.exit_code != 0) {
+            job.ok = false;
+            job.output += RED + std::string("❌ Linking ") + target.target.name + " failed with error code: " +
+                          std::to_string(result.exit_code) + RESET + "\n";
+        } else {
+            recordOutput(target.output, command_hash, inputs);
+            ++linked_;
+        }
+        auto end = BuildTrace::Clock::now();
+        link_micros_ += std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+        trace_.complete("link " + target.target.name, "link", begin, end, JobScheduler::currentWorker(),
+                        {{"linker", linker_.empty() ? "default" : linker_}});
+        return job;
+    }
+
+    void writeTrace() {
+        if (!trace_.write(kTracePath, workers_used_)) {
+            std::cerr << RED << "❌ Failed to write " << kTracePath << RESET << std::endl;
+            return;
+        }
+        std::cout << GREY << "⏱️  Build trace written to " << kTracePath << "\n"
+                  << trace_.summary("compile", 10) << RESET << std::flush;
+    }
+
+    json config_;
+    BuildOptions options_;
+    std::string compiler_;
+    Toolchain toolchain_;
+    std::unique_ptr<CompileCache> cache_;
+    std::unique_ptr<RemoteWorkers> remote_;
+    std::atomic<size_t> remote_compiles_{0};
+    std::atomic<size_t> remote_fallbacks_{0};
+    std::vector<std::string> include_paths_;
+    std::vector<Dependency> dependencies_;
+    std::vector<TargetBuild> targets_;
+
+    // A module and the unit whose compile produces its BMI.
+    struct ModuleProvider {
+        const TargetBuild* target = nullptr;
+        CompileStep step;
+    };
+    std::map<std::string, ModuleUnit> module_units_;   // normalized source -> its module syntax
+    std::map<std::string, ModuleProvider> modules_;    // module -> provider
+    std::unordered_map<std::string, std::string> module_keys_; // module -> cache key of its provider
+    bool modules_used_ = false;                        // some source declares or imports a module
+    std::atomic<size_t> linked_{0};
+    std::atomic<int64_t> link_micros_{0}; // wall time spent in link jobs
+    std::string linker_;                  // -fuse-ld= value, empty for the compiler's default
+    bool prepared_ = false;               // prepare() has run for the current cppkg.json
+    bool rescan_ = true;                  // the tree listing is stale
+    BuildProfile profile_;
+    std::string out_dir_;
+    std::string pgo_dir_;
+    std::string pgo_data_;  // what -fprofile-use is pointed at
+    std::string pgo_stamp_; // hash of the profile data, folded into command hashes
+    BuildTrace trace_;
+    size_t workers_used_ = 0;
+
+    BuildState state_;
+    std::vector<std::string> tree_files_;
+    std::mutex state_mutex_;
+
+    struct FileInfo {
+        bool exists = false;
+        int64_t mtime = 0;
+        uint64_t size = 0;
+    };
+    // Per-invocation memo so a header shared by many TUs is stat'ed and
+    // hashed once.
+    std::unordered_map<std::string, FileInfo> file_info_;
+    std::unordered_map<std::string, std::string> file_hashes_;
+
+    // Declared "include_dirs" are used as-is; without them every directory
+    // of the tree that holds a header is searched.
+    std::vector<std::string> findHeaderDirectories() {
+        IncludeDirs declared = declaredIncludeDirs(config_);
+        if (declared.declared()) return declared.all();
+        return headerDirectories(tree_files_);
     }
 
     std::vector<std::string> getSourceFiles() {
@@ -89,12 +1030,9 @@ private:
             }
 
         } else {
-            for (const auto& entry : fs::recursive_directory_iterator(".")) {
-                if (entry.path().extension() == ".cpp" &&
-                    entry.path().parent_path() != "build" &&
-                    entry.path().parent_path() != "_packages") {
-
-                    sources.push_back(entry.path().string());
+            for (const auto& file : tree_files_) {
+                if (fs::path(file).extension() == ".cpp" || isModuleInterfaceFile(file)) {
+                    sources.push_back(file);
                 }
             }
         }
@@ -102,8 +1040,75 @@ private:
         return sources;
     }
     
+    // The "targets" of cppkg.json in dependency order. Projects without
+    // them build one executable, named after the project, from every source.
+    std::vector<TargetBuild> planTargets() {
+        std::vector<Target> targets;
+        if (config_.contains("targets")) {
+            targets = loadTargets(config_, tree_files_);
+        } else {
+            Target target;
+            target.name = config_["name"].get<std::string>();
+            target.sources = getSourceFiles();
+            if (target.sources.empty()) {
+                throw std::runtime_error(RED + std::string("❌ No source files found to compile") + RESET + "\n");
+            }
+            targets.push_back(std::move(target));
+        }
+
+        std::vector<TargetBuild> planned;
+        for (auto& target : targets) {
+            TargetBuild build;
+            build.output = targetOutput(target, out_dir_, compiler_ == "cl");
+            build.target = std::move(target);
+            planned.push_back(std::move(build));
+        }
+        return planned;
+    }
+
+    const TargetBuild& findTarget(const std::string& name) const {
+        for (const auto& build : targets_) {
+            if (build.target.name == name) return build;
+        }
+        throw std::runtime_error("Unknown target '" + name + "'");
+    }
+
+    // Every library `build` links against, directly or through another
+    // library, ordered so that each comes before the libraries it uses.
+    std::vector<const TargetBuild*> linkedLibraries(const TargetBuild& build) const {
+        std::set<std::string> used;
+        std::vector<std::string> pending = build.target.deps;
+        while (!pending.empty()) {
+            std::string name = pending.back();
+            pending.pop_back();
+            if (!used.insert(name).second) continue;
+            const auto& deps = findTarget(name).target.deps;
+            pending.insert(pending.end(), deps.begin(), deps.end());
+        }
+
+        std::vector<const TargetBuild*> libraries;
+        for (auto it = targets_.rbegin(); it != targets_.rend(); ++it) {
+            if (used.count(it->target.name)) libraries.push_back(&*it);
+        }
+        return libraries;
+    }
+
+    // A target's own include_dirs (or the project-wide include path) followed
+    // by the public include_dirs of the libraries it uses.
+    std::vector<std::string> targetIncludePaths(const TargetBuild& build) const {
+        const IncludeDirs& own = build.target.include_dirs;
+        std::vector<std::string> paths = own.declared() ? own.all() : include_paths_;
+        std::set<std::string> seen(paths.begin(), paths.end());
+        for (const auto* library : linkedLibraries(build)) {
+            for (const auto& dir : library->target.include_dirs.public_dirs) {
+                if (seen.insert(dir).second) paths.push_back(dir);
+            }
+        }
+        return paths;
+    }
+
     bool checkProjectStructure() {
-        if (!fs::exists(config_["exec"])) {
+        if (!config_.contains("targets") && !fs::exists(config_["exec"])) {
             std::cerr << "❌ Missing source file\n";
             return false;
         }
@@ -120,116 +1125,606 @@ private:
         return true;
     }
 
+    // The probed toolchain comes from the toolchain cache, so an unchanged
+    // compiler costs a PATH lookup and a stat rather than a process spawn.
     std::string findCompiler() {
-        std::vector<std::string> possible_compilers;
+        auto toolchain = ToolchainProbe().detect();
+        if (!toolchain) return "";
+        toolchain_ = *toolchain;
+        return toolchain_.compiler;
+    }
 
-        #ifdef _WIN32
-            possible_compilers = {"clang++", "g++", "cl"};
+    std::string statePath() const {
+        return out_dir_ + "/.cppkg_state";
+    }
+
+    // "linker" in cppkg.json: "auto" (the default) picks the fastest linker
+    // the compiler can drive, "default" leaves the choice to the compiler,
+    // anything else (mold, lld, gold, bfd) is passed to -fuse-ld= as is.
+    std::string selectLinker() {
+        std::string wanted = config_.value("linker", "auto");
+        if (compiler_ == "cl" || wanted == "default") return "";
+
+        if (wanted != "auto") {
+            if (!toolchain_.supportsLinker(wanted) && !linkerWorks(wanted)) {
+                throw std::runtime_error("Linker '" + wanted + "' from cppkg.json cannot be used by " + compiler_);
+            }
+            return wanted;
+        }
+
+        #ifdef __APPLE__
+            return "";
         #else
-            possible_compilers = {"g++", "clang++"};
+            return toolchain_.autoLinker(!profile_.lto.empty());
         #endif
+    }
+
+    bool linkerWorks(const std::string& linker) {
+        return runProcess({compiler_, "-fuse-ld=" + linker, "-Wl,--version"}).exit_code == 0;
+    }
+
+    bool isClang() const {
+        return toolchain_.isClang();
+    }
+
+    // Instrumented builds write their counters to build/<profile>/pgo/, which
+    // --pgo-use reads back. clang's raw profiles are merged with
+    // llvm-profdata first; gcc reads its .gcda files directly.
+    void preparePgo() {
+        pgo_data_.clear();
+        pgo_stamp_.clear();
+        if (options_.pgo.empty()) return;
+
+        if (compiler_ == "cl") {
+            throw std::runtime_error("PGO builds are only supported with g++ and clang++");
+        }
+
+        pgo_dir_ = fs::absolute(out_dir_ + "/pgo").lexically_normal().string();
+        fs::create_directories(pgo_dir_);
+        if (options_.pgo == "generate") return;
+
+        const std::string extension = isClang() ? ".profraw" : ".gcda";
+        std::vector<std::string> raw;
+        for (const auto& entry : fs::recursive_directory_iterator(pgo_dir_)) {
+            if (entry.path().extension() == extension) raw.push_back(entry.path().string());
+        }
+        std::sort(raw.begin(), raw.end());
+        if (raw.empty()) {
+            throw std::runtime_error("No profile data in " + pgo_dir_ + ". Build with --pgo-generate and run a workload first");
+        }
 
-        for (const auto& compiler : possible_compilers) {
-            #ifdef _WIN32
-                std::string cmd = "where " + compiler + " >nul 2>&1";
-            #else
-                std::string cmd = "command -v " + compiler + " >/dev/null 2>&1";
-            #endif
-            
-            if (system(cmd.c_str()) == 0) {
-                return compiler;
+        if (isClang()) {
+            pgo_data_ = pgo_dir_ + "/default.profdata";
+            std::vector<std::string> merge = {"llvm-profdata", "merge", "-output=" + pgo_data_};
+            merge.insert(merge.end(), raw.begin(), raw.end());
+            ProcessResult result = runProcess(merge);
+            if (result.exit_code != 0) {
+                throw std::runtime_error("llvm-profdata merge failed:\n" + result.output);
+            }
+            pgo_stamp_ = sha256File(pgo_data_);
+        } else {
+            pgo_data_ = pgo_dir_;
+            Sha256 hasher;
+            for (const auto& file : raw) {
+                hasher.field(file).field(sha256File(file));
             }
+            pgo_stamp_ = hasher.hexdigest();
         }
-        
-        return "";
     }
 
-    std::vector<Dependency> getDependencies() {
-        return {
-            {
-                "fmt", "9.0.0",
-                "_packages/fmt/9.0.0/include",
-                "_packages/fmt/9.0.0/lib/libfmt.a",
-                "static"
+    std::string sanitizerList() const {
+        std::string list;
+        for (const auto& sanitizer : options_.sanitize) {
+            list += (list.empty() ? "" : ",") + sanitizer;
+        }
+        return list;
+    }
+
+    // Rejects instrumentation the compiler or the other options rule out.
+    void checkInstrumentation() const {
+        const auto& sanitize = options_.sanitize;
+        auto uses = [&](const char* name) { return std::find(sanitize.begin(), sanitize.end(), name) != sanitize.end(); };
+
+        if (uses("thread") && (uses("address") || uses("leak"))) {
+            throw std::runtime_error("--sanitize=thread cannot be combined with address or leak");
+        }
+        if (compiler_ == "cl") {
+            if (options_.coverage) throw std::runtime_error("--coverage is only supported with g++ and clang++");
+            for (const auto& sanitizer : sanitize) {
+                if (sanitizer != "address") throw std::runtime_error("cl only supports --sanitize=address");
             }
-        };
+        }
+        if (options_.coverage && !options_.pgo.empty()) {
+            throw std::runtime_error("--coverage cannot be combined with PGO builds");
+        }
     }
 
-    std::string buildCompilationCommand() {
-        auto compiler = findCompiler();
-        if (compiler.empty()) {
-            throw std::runtime_error(getCompilerInstallInstructions());
+    // Flags shared by compiling and linking: the profile, LTO, PGO,
+    // sanitizers and coverage.
+    std::vector<std::string> codegenFlags() const {
+        std::vector<std::string> flags = profile_.flags;
+
+        if (compiler_ == "cl") {
+            if (!profile_.lto.empty()) flags.push_back("/GL");
+            if (!options_.sanitize.empty()) flags.push_back("/fsanitize=address");
+            return flags;
+        }
+
+        if (!options_.sanitize.empty()) {
+            flags.insert(flags.end(), {"-fsanitize=" + sanitizerList(), "-fno-omit-frame-pointer"});
+        }
+        if (options_.coverage) {
+            if (isClang()) {
+                flags.insert(flags.end(), {"-fprofile-instr-generate", "-fcoverage-mapping"});
+            } else {
+                flags.push_back("--coverage");
+            }
+        }
+
+        // LTO generates code at link time, so this is needed there too.
+        if (profile_.split_dwarf) flags.push_back("-gsplit-dwarf");
+
+        // gcc has no ThinLTO; its parallel LTO partitioning is the nearest.
+        if (profile_.lto == "thin" && isClang()) {
+            flags.push_back("-flto=thin");
+        } else if (!profile_.lto.empty()) {
+            flags.push_back(isClang() ? "-flto" : "-flto=auto");
+        }
+
+        if (options_.pgo == "generate") {
+            flags.push_back("-fprofile-generate=" + pgo_dir_);
+        } else if (options_.pgo == "use") {
+            flags.push_back("-fprofile-use=" + pgo_data_);
+            if (!isClang()) flags.insert(flags.end(), {"-fprofile-correction", "-Wno-missing-profile"});
+        }
+        return flags;
+    }
+
+    // Dependencies come from cppkg.lock; the lock is re-resolved when the
+    // "dependencies" in cppkg.json no longer match what it was made from.
+    // Packages missing from _packages/ are fetched before anything compiles,
+    // and packages that ship sources are built into the shared prefix.
+    std::vector<Dependency> getDependencies() {
+        auto declared = declaredDependencies(config_);
+        auto lock = Lockfile::load();
+        if (!lock || !lock->isCurrent(declared)) {
+            if (declared.empty()) return {};
+
+            std::cout << YELLOW << "🔒 cppkg.lock is out of date, resolving dependencies..." << RESET << std::endl;
+            Registry registry(Registry::locate(config_.value("registry", "")));
+            lock = resolveLockfile(registry, declared);
+            lock->save();
+        }
+
+        if (!PackageFetcher(options_.jobs).fetch(*lock)) {
+            throw std::runtime_error(RED + std::string("❌ Failed to fetch dependencies") + RESET);
         }
-        auto source_files = getSourceFiles();
-        if (source_files.empty()) {
-            throw std::runtime_error(RED + std::string("❌ No source files found to compile") + RESET + "\n");
+
+        DependencyBuilder builder(compiler_, toolchain_.identity(), config_["cpp_version"].get<std::string>(), options_.jobs);
+        return lock->dependencies(builder.build(*lock));
+    }
+
+    CompileStep makeCompileStep(const TargetBuild& build, const std::string& source) {
+        fs::path relative = fs::path(source).lexically_normal();
+        std::string object = (fs::path(out_dir_) / "obj" / build.target.name / relative).string() + ".o";
+        CompileStep step;
+        step.source = source;
+        step.object = object;
+        step.depfile = object.substr(0, object.size() - 2) + ".d";
+
+        auto unit = module_units_.find(relative.generic_string());
+        if (unit != module_units_.end()) {
+            step.module = unit->second;
+            if (!step.module.provides.empty()) step.bmi = bmiPath(step.module.provides);
         }
-        std::string cmd;
+        return step;
+    }
+
+    // Flags shared by the compile and preprocess commands of every source
+    // of a target.
+    std::vector<std::string> compileFlags(const TargetBuild& build) {
+        std::vector<std::string> cmd;
         auto cpp_version = config_["cpp_version"].get<std::string>();
-        auto name = config_["name"].get<std::string>();
-        std::vector<std::string> include_paths = findHeaderDirectories();
-        auto dependencies = getDependencies();
 
-        if (compiler == "cl") {
+        if (compiler_ == "cl") {
             // Windows (MSVC)
-            cmd = compiler + 
-                " /std:" + cpp_version +
-                " /EHsc /nologo";
+            cmd = {compiler_, "/std:" + cpp_version, "/EHsc", "/nologo"};
+            auto codegen = codegenFlags();
+            cmd.insert(cmd.end(), codegen.begin(), codegen.end());
+            if (modules_used_) cmd.insert(cmd.end(), {"/ifcSearchDir", out_dir_ + "/bmi"});
 
-            for (const auto& path : include_paths) {
-                cmd += " /I\"" + path + "\"";
+            for (const auto& path : build.include_paths) {
+                cmd.push_back("/I" + path);
             }
 
-            for (const auto& dep : dependencies) {
+            for (const auto& dep : dependencies_) {
                 if (!dep.include_path.empty()) {
-                    cmd += " /I\"" + dep.include_path + "\"";
+                    cmd.push_back("/I" + dep.include_path);
                 }
             }
 
-            cmd += " /Fobuild/ /Febuild/" + name;
+        } else {
+            // Linux/macOS (g++/clang++)
+            cmd = {compiler_, "-std=" + cpp_version, "-Wall", "-Wextra", "-pedantic"};
+            auto codegen = codegenFlags();
+            cmd.insert(cmd.end(), codegen.begin(), codegen.end());
 
-            for (const auto& src : source_files) {
-                cmd += " \"" + src + "\"";
+            // Static libraries may end up inside a shared one.
+            if (build.target.isLibrary()) cmd.push_back("-fPIC");
+
+            // clang++ finds BMIs by module name, g++ through the mapper file.
+            if (modules_used_ && isClang()) {
+                cmd.push_back("-fprebuilt-module-path=" + out_dir_ + "/bmi");
+            } else if (modules_used_) {
+                // -Mno-modules keeps module rules out of depfiles, which ninja
+                // could not read; the BMIs are tracked separately.
+                cmd.insert(cmd.end(), {"-fmodules-ts", "-fmodule-mapper=" + moduleMapperPath(), "-Mno-modules"});
             }
 
-            for (const auto& dep : dependencies) {
-                if (dep.type == "static" && !dep.library_path.empty()) {
-                    cmd += " \"" + dep.library_path + "\"";
+            for (const auto& path : build.include_paths) {
+                cmd.push_back("-I" + path);
+            }
+
+            for (const auto& dep : dependencies_) {
+                if (!dep.include_path.empty()) {
+                    cmd.push_back("-I" + dep.include_path);
                 }
             }
 
+        }
+
+        return cmd;
+    }
+
+    // Replaces the sources by generated unity files of `options_.unity`
+    // sources each. Files listed under "unity": {"exclude": [...]} in
+    // cppkg.json, module units and batches of a single file are compiled
+    // on their own.
+    std::vector<std::string> unityUnits(const TargetBuild& build) {
+        const auto& sources = build.target.sources;
+        std::unordered_set<std::string> excluded;
+        if (config_.contains("unity") && config_["unity"].is_object()) {
+            for (const auto& path : config_["unity"].value("exclude", std::vector<std::string>{})) {
+                excluded.insert(fs::path(path).lexically_normal().generic_string());
+            }
+        }
+
+        std::vector<std::string> units;
+        std::vector<std::string> batched;
+        for (const auto& source : sources) {
+            std::string normalized = fs::path(source).lexically_normal().generic_string();
+            bool skip = excluded.count(normalized) > 0 || module_units_.count(normalized) > 0;
+            (skip ? units : batched).push_back(source);
+        }
+
+        size_t files = 0;
+        for (const auto& batch : planUnityBatches(batched, options_.unity, out_dir_ + "/unity/" + build.target.name)) {
+            if (batch.sources.size() == 1) {
+                units.push_back(batch.sources.front());
+                continue;
+            }
+            fs::create_directories(fs::path(batch.path).parent_path());
+            writeIfChanged(batch.path, unitySource(batch));
+            units.push_back(batch.path);
+            ++files;
+        }
+
+        std::cout << GREY << "🧱 Unity build of " << build.target.name << ": " << sources.size() << " source(s) in " << units.size()
+                  << " translation unit(s), " << files << " generated" << RESET << std::endl;
+        return units;
+    }
+
+    // The "pch" setting of cppkg.json is either a list of headers or "auto"
+    // for the headers most sources include. They are gathered into
+    // build/<profile>/pch/<target>/cppkg_pch.hpp, which every source of the
+    // target is compiled with via -include; g++ and clang++ pick up the
+    // .gch/.pch built next to it.
+    std::optional<CompileStep> preparePch(TargetBuild& build) {
+        build.pch_flags.clear();
+        if (!config_.contains("pch")) return std::nullopt;
+
+        std::vector<std::string> headers;
+        const json& setting = config_["pch"];
+        if (setting.is_string() && setting.get<std::string>() == "auto") {
+            headers = detectCommonHeaders(build.target.sources);
+        } else if (setting.is_array()) {
+            for (const auto& header : setting) {
+                if (header.is_string()) headers.push_back(header.get<std::string>());
+            }
+        }
+        if (headers.empty()) return std::nullopt;
+
+        if (compiler_ == "cl") {
+            std::cout << GREY << "ℹ️  Precompiled headers are not supported with cl, skipping" << RESET << std::endl;
+            return std::nullopt;
+        }
+        // With -fmodules-ts, g++ builds the header as a header unit instead.
+        if (modules_used_ && !isClang()) {
+            std::cout << GREY << "ℹ️  Precompiled headers are not used alongside modules with g++, skipping" << RESET << std::endl;
+            return std::nullopt;
+        }
+
+        const std::string directory = out_dir_ + "/pch/" + build.target.name;
+        fs::create_directories(directory);
+        const std::string header = directory + "/cppkg_pch.hpp";
+        writeIfChanged(header, pchSource(headers));
+
+        std::string output = header + (isClang() ? ".pch" : ".gch");
+        build.pch_flags = {"-include", header};
+        if (!isClang()) build.pch_flags.push_back("-Winvalid-pch");
+        CompileStep step;
+        step.source = header;
+        step.object = output;
+        step.depfile = directory + "/cppkg_pch.d";
+        return step;
+    }
+
+    std::vector<std::string> buildPchCommand(const TargetBuild& build, const CompileStep& step) {
+        std::vector<std::string> cmd = build.compile_flags;
+        cmd.insert(cmd.end(), {"-x", "c++-header", "-MMD", "-MF", step.depfile});
+        cmd.insert(cmd.end(), {"-c", step.source, "-o", step.object});
+        return cmd;
+    }
+
+    std::vector<std::string> buildCompilationCommand(const TargetBuild& build, const CompileStep& step) {
+        std::vector<std::string> cmd = build.compile_flags;
+        // A forced include would come before the module declaration.
+        if (step.module.name.empty()) cmd.insert(cmd.end(), build.pch_flags.begin(), build.pch_flags.end());
+        std::vector<std::string> language = languageFlags(step);
+
+        if (compiler_ == "cl") {
+            cmd.insert(cmd.end(), language.begin(), language.end());
+            if (!step.bmi.empty()) cmd.insert(cmd.end(), {"/ifcOutput", step.bmi});
+            cmd.insert(cmd.end(), {"/c", "/Fo" + step.object, step.source});
         } else {
-            // Linux/macOS (g++/clang++)
-            cmd = compiler + 
-                " -std=" + cpp_version +
-                " -Wall -Wextra -pedantic";
+            cmd.insert(cmd.end(), {"-MMD", "-MF", step.depfile});
+            if (!step.bmi.empty() && isClang()) cmd.push_back("-fmodule-output=" + step.bmi);
+            cmd.insert(cmd.end(), language.begin(), language.end());
+            cmd.insert(cmd.end(), {"-c", step.source, "-o", step.object});
+        }
+
+        return cmd;
+    }
+
+    // What a module unit needs ahead of its source to be compiled as one:
+    // g++ does not know the .cppm and .ixx extensions, clang++ only treats
+    // .cppm files as module units by default, cl only .ixx files.
+    std::vector<std::string> languageFlags(const CompileStep& step) const {
+        std::string extension = fs::path(step.source).extension().string();
+        if (compiler_ == "cl") {
+            if (step.module.provides.empty() || extension == ".ixx") return {};
+            return {step.module.interface ? "/interface" : "/internalPartition"};
+        }
+        if (isClang()) {
+            if (step.module.provides.empty() || extension == ".cppm") return {};
+            return {"-x", "c++-module"};
+        }
+        if (isModuleInterfaceFile(step.source)) return {"-x", "c++"};
+        return {};
+    }
+
+    // Hashes the compiler identity, the flags and the preprocessed source,
+    // and for importers the keys of the modules they use.
+    // Output paths are left out so the key only depends on what is compiled.
+    // Returns an empty key if preprocessing fails; the real compile will
+    // then report the error.
+    std::string cacheKey(const TargetBuild& build, const CompileStep& step) {
+        ProcessResult preprocessed = runProcess(preprocessCommand(build, step));
+        if (preprocessed.exit_code != 0) return "";
+        return cacheKey(build, step, preprocessed.output);
+    }
+
+    std::string cacheKey(const TargetBuild& build, const CompileStep& step, const std::string& preprocessed) {
+        Sha256 hasher;
+        hasher.field(toolchain_.identity());
+        for (const auto& arg : preprocessCommand(build, step)) {
+            hasher.field(arg);
+        }
+        hasher.update(preprocessed);
+        for (const auto& module : step.imports) {
+            std::string key = moduleKey(module);
+            if (key.empty()) return "";
+            hasher.field(module).field(key);
+        }
+
+        std::string key = hasher.hexdigest();
+        if (!step.module.provides.empty()) {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            module_keys_[step.module.provides] = key;
+        }
+        return key;
+    }
+
+    std::vector<std::string> preprocessCommand(const TargetBuild& build, const CompileStep& step) const {
+        std::vector<std::string> cmd = build.compile_flags;
+        if (step.module.name.empty()) cmd.insert(cmd.end(), build.pch_flags.begin(), build.pch_flags.end());
+        std::vector<std::string> language = languageFlags(step);
+        cmd.insert(cmd.end(), language.begin(), language.end());
+        cmd.insert(cmd.end(), {"-E", step.source});
+        return cmd;
+    }
+
+    // Preprocesses `step` for a worker, writing its depfile on the way.
+    // False if that fails; the local compile then reports the error.
+    bool preprocess(const TargetBuild& build, const CompileStep& step, std::string& preprocessed) {
+        std::string output = step.object.substr(0, step.object.size() - 2) + ".ii";
+        std::vector<std::string> cmd = preprocessCommand(build, step);
+        cmd.insert(cmd.end(), {"-o", output, "-MMD", "-MF", step.depfile, "-MT", step.object});
+
+        bool ok = runProcess(cmd).exit_code == 0;
+        if (ok) {
+            std::ifstream file(output, std::ios::binary);
+            std::stringstream buffer;
+            buffer << file.rdbuf();
+            preprocessed = buffer.str();
+        }
+        std::error_code ec;
+        fs::remove(output, ec);
+        return ok;
+    }
 
-            for (const auto& path : include_paths) {
-                cmd += " -I\"" + path + "\"";
+    // Workers only see the preprocessed source and the flags, so compiles
+    // that read other files (BMIs, PGO data) or write files besides the
+    // object (.dwo, .gcno, time traces) stay here.
+    bool canCompileRemotely(const TargetBuild& build, bool time_trace) const {
+        if (modules_used_ || profile_.split_dwarf || options_.coverage || !options_.pgo.empty() || time_trace) {
+            return false;
+        }
+        auto args = remoteArgs(build);
+        return std::all_of(args.begin(), args.end(), remoteArgumentAllowed);
+    }
+
+    // Include paths and macros were applied by preprocessing.
+    std::vector<std::string> remoteArgs(const TargetBuild& build) const {
+        std::vector<std::string> args;
+        for (size_t i = 1; i < build.compile_flags.size(); ++i) {
+            const std::string& arg = build.compile_flags[i];
+            if (arg.rfind("-I", 0) == 0 || arg.rfind("-D", 0) == 0 || arg.rfind("-U", 0) == 0) continue;
+            args.push_back(arg);
+        }
+        return args;
+    }
+
+    // Written aside and renamed, so a failed write leaves no object behind.
+    static bool writeObject(const std::string& path, const std::string& content) {
+        std::string temp = path + ".tmp";
+        {
+            std::ofstream file(temp, std::ios::binary);
+            if (!(file << content)) return false;
+        }
+        std::error_code ec;
+        fs::rename(temp, path, ec);
+        if (ec) fs::remove(temp, ec);
+        return !ec;
+    }
+
+    // Compiles at once on this machine: -j, or every core.
+    size_t localSlots() const {
+        return options_.jobs ? options_.jobs : std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // CPPKG_WORKERS lists worker addresses separated by commas or spaces.
+    static std::vector<std::string> workersFromEnvironment() {
+        std::vector<std::string> workers;
+        const char* value = std::getenv("CPPKG_WORKERS");
+        std::string list = value ? value : "";
+        std::replace(list.begin(), list.end(), ',', ' ');
+        std::istringstream stream(list);
+        std::string worker;
+        while (stream >> worker) workers.push_back(worker);
+        return workers;
+    }
+
+    // Stands for a module's BMI in the cache keys of its importers. The BMI
+    // itself will not do: g++ never writes the same one twice. Empty for a
+    // module nothing provides, which leaves the importer uncached.
+    std::string moduleKey(const std::string& module) {
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            auto it = module_keys_.find(module);
+            if (it != module_keys_.end()) return it->second;
+        }
+        auto provider = modules_.find(module);
+        if (provider == modules_.end()) return "";
+        return cacheKey(*provider->second.target, provider->second.step);
+    }
+
+    // Static libraries are archived; shared libraries and executables are
+    // linked against the project libraries they use and the package
+    // libraries.
+    std::vector<std::string> buildLinkCommand(const TargetBuild& build) {
+        std::vector<std::string> cmd;
+        const auto& objects = build.objects;
+
+        if (build.target.type == "static") {
+            if (compiler_ == "cl") {
+                cmd = {"lib", "/nologo", "/OUT:" + build.output};
+            } else {
+                // LTO objects need the archiver that understands them.
+                std::string archiver = profile_.lto.empty() ? "ar" : (isClang() ? "llvm-ar" : "gcc-ar");
+                cmd = {archiver, "rcs", build.output};
             }
+            cmd.insert(cmd.end(), objects.begin(), objects.end());
+            return cmd;
+        }
 
-            for (const auto& dep : dependencies) {
-                if (!dep.include_path.empty()) {
-                    cmd += " -I\"" + dep.include_path + "\"";
+        std::vector<const TargetBuild*> libraries = linkedLibraries(build);
+
+        if (compiler_ == "cl") {
+            cmd = {compiler_, "/nologo"};
+            if (build.target.type == "shared") cmd.push_back("/LD");
+            cmd.push_back("/Fe" + build.output);
+            cmd.insert(cmd.end(), objects.begin(), objects.end());
+
+            for (const auto* library : libraries) {
+                cmd.push_back(library->output);
+            }
+
+            for (const auto& dep : dependencies_) {
+                if (dep.type == "static" && !dep.library_path.empty()) {
+                    cmd.push_back(dep.library_path);
                 }
             }
 
-            cmd += " -o build/" + name;
+            if (!profile_.lto.empty() || !profile_.link_flags.empty()) {
+                cmd.push_back("/link");
+                if (!profile_.lto.empty()) cmd.push_back("/LTCG");
+                cmd.insert(cmd.end(), profile_.link_flags.begin(), profile_.link_flags.end());
+            }
+
+        } else {
+            // LTO and PGO need the code generation flags again at link time.
+            cmd = {compiler_};
+            auto codegen = codegenFlags();
+            cmd.insert(cmd.end(), codegen.begin(), codegen.end());
+            if (build.target.type == "shared") cmd.push_back("-shared");
+            if (!linker_.empty()) cmd.push_back("-fuse-ld=" + linker_);
+            // GNU ld has no --gdb-index; gold, lld and mold do.
+            if (profile_.split_dwarf && !linker_.empty() && linker_ != "bfd") cmd.push_back("-Wl,--gdb-index");
+            cmd.insert(cmd.end(), {"-o", build.output});
+            cmd.insert(cmd.end(), objects.begin(), objects.end());
 
-            for (const auto& src : source_files) {
-                cmd += " \"" + src + "\"";
+            bool shared = false;
+            for (const auto* library : libraries) {
+                cmd.push_back(library->output);
+                shared = shared || library->target.type == "shared";
             }
 
-            for (const auto& dep : dependencies) {
+            for (const auto& dep : dependencies_) {
                 if ((dep.type == "static" || dep.type == "shared") && !dep.library_path.empty()) {
-                    cmd += " \"" + dep.library_path + "\"";
+                    cmd.push_back(dep.library_path);
                 }
             }
+
+            // Project shared libraries sit next to the binaries using them.
+            if (shared) {
+                #ifdef __APPLE__
+                    cmd.push_back("-Wl,-rpath,@loader_path");
+                #else
+                    cmd.push_back("-Wl,-rpath,$ORIGIN");
+                #endif
+            }
+
+            cmd.insert(cmd.end(), profile_.link_flags.begin(), profile_.link_flags.end());
         }
 
         return cmd;
     }
 
+    // What a link reads: the target's objects and every library it links.
+    std::vector<std::string> linkInputs(const TargetBuild& build) const {
+        std::vector<std::string> inputs = build.objects;
+        if (build.target.type == "static") return inputs;
+
+        for (const auto* library : linkedLibraries(build)) {
+            inputs.push_back(library->output);
+        }
+        for (const auto& dep : dependencies_) {
+            if (!dep.library_path.empty()) inputs.push_back(dep.library_path);
+        }
+        return inputs;
+    }
+
     std::string getCompilerInstallInstructions() {
         std::stringstream oss;
         oss << RED << "❌ Compiler not found. Please install one of the following:" << RESET << std::endl;
@@ -241,16 +1736,167 @@ private:
         #elif __APPLE__
             oss << YELLOW << "1. Xcode Command Line Tools: xcode-select --install" << RESET << std::endl;
         #endif
+        if (const char* cxx = std::getenv("CXX"); cxx && *cxx) {
+            oss << YELLOW << "CXX is set to '" << cxx << "', which was not found" << RESET << std::endl;
+        }
         return oss.str();
     }
 
-    bool needsRebuild(const std::string& source, const std::string& object) {
-        if (!fs::exists(object)) return true;
+    static std::string hashCommand(const std::vector<std::string>& cmd, const std::string& salt = "") {
+        Sha256 hasher;
+        for (const auto& arg : cmd) {
+            hasher.field(arg);
+        }
+        hasher.field(salt);
+        return hasher.hexdigest();
+    }
+
+    FileInfo statFile(const std::string& path) {
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            auto it = file_info_.find(path);
+            if (it != file_info_.end()) return it->second;
+        }
+
+        FileInfo info;
+        std::error_code ec;
+        auto time = fs::last_write_time(path, ec);
+        if (!ec) {
+            info.mtime = fileTimeTicks(time);
+            info.size = fs::file_size(path, ec);
+            info.exists = !ec;
+        }
+
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        file_info_[path] = info;
+        return info;
+    }
+
+    // Drops what is memoized about a file this build is about to rewrite.
+    void forget(const std::string& path) {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        file_info_.erase(path);
+        file_hashes_.erase(path);
+    }
+
+    std::string hashFile(const std::string& path) {
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            auto it = file_hashes_.find(path);
+            if (it != file_hashes_.end()) return it->second;
+        }
+
+        std::string hash = sha256File(path);
+
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        file_hashes_[path] = hash;
+        return hash;
+    }
 
-        auto src_time = fs::last_write_time(source);
-        auto obj_time = fs::last_write_time(object);
+    // An object is current when it was built by the same command from inputs
+    // that are unchanged; inputs whose mtime moved but whose content did not
+    // (e.g. after a branch switch) do not trigger a rebuild.
+    bool needsRebuild(const CompileStep& step, const std::string& command_hash) {
+        if (!fs::exists(step.object)) return true;
+        if (!step.bmi.empty() && !fs::exists(step.bmi)) return true;
 
-        return src_time > obj_time;
+        auto record = state_.steps.find(step.object);
+        if (record == state_.steps.end()) {
+            return needsRebuildByTimestamp(step);
+        }
+
+        return !isCurrent(record->second, command_hash);
+    }
+
+    // A link output is current when it was made by the same command from
+    // inputs with unchanged content, so recompiling a library to identical
+    // objects relinks nothing. Called from worker threads.
+    bool needsLink(const std::string& output, const std::string& command_hash) {
+        if (!fs::exists(output)) return true;
+
+        StepRecord record;
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            auto it = state_.steps.find(output);
+            if (it == state_.steps.end()) return true;
+            record = it->second;
+        }
+        return !isCurrent(record, command_hash);
+    }
+
+    bool isCurrent(const StepRecord& record, const std::string& command_hash) {
+        if (record.command_hash != command_hash) return false;
+
+        for (const auto& prerequisite : record.prerequisites) {
+            FileInfo info = statFile(prerequisite.path);
+            if (!info.exists) return false;
+            if (info.mtime == prerequisite.mtime && info.size == prerequisite.size) continue;
+            if (info.size != prerequisite.size || hashFile(prerequisite.path) != prerequisite.hash) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Used for objects the build state knows nothing about yet.
+    bool needsRebuildByTimestamp(const CompileStep& step) {
+        auto obj_time = fs::last_write_time(step.object);
+        if (fs::last_write_time(step.source) > obj_time) return true;
+
+        // MSVC has no depfile; fall back to the source timestamp alone.
+        if (compiler_ == "cl") return false;
+        if (!fs::exists(step.depfile)) return true;
+
+        std::error_code ec;
+        for (const auto& prerequisite : parseDepfile(step.depfile)) {
+            auto time = fs::last_write_time(prerequisite, ec);
+            if (ec || time > obj_time) return true;
+        }
+
+        return false;
+    }
+
+    // Snapshots the inputs of a freshly built object. Called from worker
+    // threads once the object and its depfile are in place. Depfiles do not
+    // list the BMIs read, so those are added.
+    void recordStep(const CompileStep& step, const std::string& command_hash) {
+        std::vector<std::string> prerequisites = compiler_ == "cl"
+            ? std::vector<std::string>{step.source}
+            : parseDepfile(step.depfile);
+        for (const auto& module : step.imports) {
+            prerequisites.push_back(bmiPath(module));
+        }
+        recordOutput(step.object, command_hash, prerequisites);
+    }
+
+    void recordOutput(const std::string& output, const std::string& command_hash,
+                      const std::vector<std::string>& prerequisites) {
+        StepRecord record;
+        record.command_hash = command_hash;
+        for (const auto& path : prerequisites) {
+            FileInfo info = statFile(path);
+            if (!info.exists) return;
+            record.prerequisites.push_back({path, info.mtime, info.size, hashFile(path)});
+        }
+
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        state_.steps[output] = std::move(record);
+    }
+
+    // Drops records of objects and outputs that are no longer part of the
+    // build.
+    void saveState() {
+        std::unordered_set<std::string> live;
+        for (const auto& build : targets_) {
+            live.insert(build.objects.begin(), build.objects.end());
+            if (build.pch) live.insert(build.pch->object);
+            live.insert(build.output);
+        }
+        for (auto it = state_.steps.begin(); it != state_.steps.end();) {
+            it = live.count(it->first) ? std::next(it) : state_.steps.erase(it);
+        }
+        state_.save(statePath());
     }
 };
 
@@ -0,0 +1,286 @@
+#ifndef QUICK_CPPKG_CACHE_HPP
+#define QUICK_CPPKG_CACHE_HPP
+
+#include "command.hpp"
+#include "nlohmann/json.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+    #include <fcntl.h>
+    #include <linux/fs.h>
+    #include <sys/ioctl.h>
+    #include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+struct CacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t size = 0;
+    uint64_t max_size = 0;
+};
+
+// Content-addressed object store shared by every project on the machine.
+// Entries live in <root>/objects/<2 hex>/<key>.{o,d}, plus <key>.bmi for
+// module interfaces; an entry's mtime is refreshed on every hit and is what
+// LRU eviction orders by.
+class CompileCache {
+public:
+    explicit CompileCache(fs::path root = defaultDirectory()) : root_(std::move(root)) {}
+
+    static fs::path defaultDirectory() {
+        if (const char* dir = std::getenv("CPPKG_CACHE_DIR")) return dir;
+        if (const char* xdg = std::getenv("XDG_CACHE_HOME")) return fs::path(xdg) / "cppkg";
+        #ifdef _WIN32
+            if (const char* local = std::getenv("LOCALAPPDATA")) return fs::path(local) / "cppkg" / "cache";
+        #else
+            if (const char* home = std::getenv("HOME")) return fs::path(home) / ".cache" / "cppkg";
+        #endif
+        return fs::temp_directory_path() / "cppkg-cache";
+    }
+
+    // CPPKG_CACHE_MAX_SIZE accepts a byte count with an optional K/M/G suffix.
+    static uint64_t maxSize() {
+        const char* value = std::getenv("CPPKG_CACHE_MAX_SIZE");
+        if (!value || !*value) return 5ull << 30;
+
+        char* end = nullptr;
+        uint64_t size = std::strtoull(value, &end, 10);
+        switch (end ? *end : '\0') {
+            case 'K': case 'k': size <<= 10; break;
+            case 'M': case 'm': size <<= 20; break;
+            case 'G': case 'g': size <<= 30; break;
+            default: break;
+        }
+        return size;
+    }
+
+    const fs::path& root() const { return root_; }
+
+    // Places the cached object and depfile for `key` at the given paths,
+    // and the module's BMI at `bmi` unless that is empty.
+    bool fetch(const std::string& key, const std::string& object, const std::string& depfile,
+               const std::string& bmi = "") {
+        fs::path entry = entryPath(key);
+        std::error_code ec;
+
+        if (!fs::exists(entry.string() + ".o", ec) || (!bmi.empty() && !fs::exists(entry.string() + ".bmi", ec))) {
+            ++misses_;
+            return false;
+        }
+
+        fs::remove(object, ec);
+        if (!bmi.empty()) fs::remove(bmi, ec);
+        if (!materialize(entry.string() + ".o", object) || (!bmi.empty() && !materialize(entry.string() + ".bmi", bmi))) {
+            ++misses_;
+            return false;
+        }
+        fs::copy_file(entry.string() + ".d", depfile, fs::copy_options::overwrite_existing, ec);
+
+        // Hard links share the entry's old mtime; bump it so the object is
+        // newer than its sources, which also marks the entry recently used.
+        fs::last_write_time(object, fs::file_time_type::clock::now(), ec);
+        fs::last_write_time(entry.string() + ".o", fs::file_time_type::clock::now(), ec);
+
+        ++hits_;
+        return true;
+    }
+
+    void store(const std::string& key, const std::string& object, const std::string& depfile,
+               const std::string& bmi = "") {
+        fs::path entry = entryPath(key);
+        std::error_code ec;
+        fs::create_directories(entry.parent_path(), ec);
+        if (ec) return;
+
+        // Write under a unique name and rename so concurrent builds never
+        // observe a half-written entry.
+        std::string tmp = entry.string() + ".tmp" +
+            std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()) ^
+                           static_cast<size_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+        if (!fs::exists(depfile) ||
+            !fs::copy_file(depfile, tmp + ".d", fs::copy_options::overwrite_existing, ec) ||
+            (!bmi.empty() && !fs::copy_file(bmi, tmp + ".bmi", fs::copy_options::overwrite_existing, ec)) ||
+            !fs::copy_file(object, tmp + ".o", fs::copy_options::overwrite_existing, ec)) {
+            fs::remove(tmp + ".d", ec);
+            fs::remove(tmp + ".bmi", ec);
+            fs::remove(tmp + ".o", ec);
+            return;
+        }
+
+        // The object goes last: an entry counts as present once it is there.
+        fs::rename(tmp + ".d", entry.string() + ".d", ec);
+        if (!bmi.empty()) {
+            fs::rename(tmp + ".bmi", entry.string() + ".bmi", ec);
+            added_ += fs::file_size(entry.string() + ".bmi", ec);
+        }
+        fs::rename(tmp + ".o", entry.string() + ".o", ec);
+        added_ += fs::file_size(entry.string() + ".o", ec);
+    }
+
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+
+    // Folds this run's counters into stats.json and evicts if over budget.
+    void flush() {
+        CacheStats stats = readStats();
+        stats.hits += hits_;
+        stats.misses += misses_;
+        stats.size += added_;
+        stats.max_size = maxSize();
+
+        if (stats.size > stats.max_size) {
+            stats.size = evict(stats.max_size / 10 * 9);
+        }
+
+        writeStats(stats);
+        hits_ = misses_ = added_ = 0;
+    }
+
+    CacheStats readStats() const {
+        CacheStats stats;
+        std::ifstream file(root_ / "stats.json");
+        if (!file) return stats;
+
+        try {
+            json data = json::parse(file);
+            stats.hits = data.value("hits", uint64_t{0});
+            stats.misses = data.value("misses", uint64_t{0});
+            stats.size = data.value("size", uint64_t{0});
+            stats.max_size = data.value("max_size", uint64_t{0});
+        } catch (const json::exception&) {
+        }
+        return stats;
+    }
+
+    void clear() {
+        std::error_code ec;
+        fs::remove_all(root_ / "objects", ec);
+        fs::remove(root_ / "stats.json", ec);
+    }
+
+private:
+    fs::path root_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> added_{0};
+
+    fs::path entryPath(const std::string& key) const {
+        return root_ / "objects" / key.substr(0, 2) / key;
+    }
+
+    // Prefers a reflink (copy-on-write clone), then a hard link, then a copy.
+    static bool materialize(const fs::path& from, const fs::path& to) {
+        std::error_code ec;
+
+        #ifdef __linux__
+            int src = open(from.c_str(), O_RDONLY | O_CLOEXEC);
+            if (src >= 0) {
+                int dst = open(to.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+                bool cloned = dst >= 0 && ioctl(dst, FICLONE, src) == 0;
+                if (dst >= 0) close(dst);
+                close(src);
+                if (cloned) return true;
+                fs::remove(to, ec);
+            }
+        #endif
+
+        fs::create_hard_link(from, to, ec);
+        if (!ec) return true;
+
+        return fs::copy_file(from, to, fs::copy_options::overwrite_existing, ec);
+    }
+
+    void writeStats(const CacheStats& stats) const {
+        std::error_code ec;
+        fs::create_directories(root_, ec);
+
+        std::ofstream file(root_ / "stats.json");
+        file << json{
+            {"hits", stats.hits},
+            {"misses", stats.misses},
+            {"size", stats.size},
+            {"max_size", stats.max_size}
+        }.dump(2);
+    }
+
+    // Removes least recently used entries until at most `target` bytes
+    // remain, and returns the resulting size.
+    uint64_t evict(uint64_t target) const {
+        struct Entry {
+            fs::file_time_type time;
+            fs::path path;
+            uint64_t size;
+        };
+
+        std::vector<Entry> entries;
+        uint64_t total = 0;
+        std::error_code ec;
+
+        for (const auto& item : fs::recursive_directory_iterator(root_ / "objects", ec)) {
+            if (item.path().extension() != ".o") continue;
+            fs::path bmi = item.path();
+            bmi.replace_extension(".bmi");
+            std::error_code bmi_ec;
+            uint64_t size = item.file_size(ec) + (fs::exists(bmi, bmi_ec) ? fs::file_size(bmi, bmi_ec) : 0);
+            entries.push_back({item.last_write_time(ec), item.path(), size});
+            total += size;
+        }
+
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+            return a.time < b.time;
+        });
+
+        for (const auto& entry : entries) {
+            if (total <= target) break;
+            fs::remove(entry.path, ec);
+            fs::path depfile = entry.path;
+            fs::remove(depfile.replace_extension(".d"), ec);
+            fs::remove(depfile.replace_extension(".bmi"), ec);
+            total -= entry.size;
+        }
+
+        return total;
+    }
+};
+
+class CacheHandler : public CommandHandler {
+public:
+    explicit CacheHandler(const std::string& action) : action_(action) {}
+
+    void execute() override {
+        CompileCache cache;
+
+        if (action_ == "clear") {
+            cache.clear();
+            std::cout << "Cleared compilation cache at " << cache.root().string() << "\n";
+            return;
+        }
+
+        CacheStats stats = cache.readStats();
+        uint64_t lookups = stats.hits + stats.misses;
+        std::cout << "Cache directory: " << cache.root().string() << "\n"
+                  << "Hits:            " << stats.hits << "\n"
+                  << "Misses:          " << stats.misses << "\n"
+                  << "Hit rate:        " << (lookups ? stats.hits * 100 / lookups : 0) << "%\n"
+                  << "Size:            " << stats.size / (1 << 20) << " MiB / "
+                  << CompileCache::maxSize() / (1 << 20) << " MiB\n";
+    }
+
+private:
+    std::string action_;
+};
+
+#endif
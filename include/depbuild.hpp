@@ -0,0 +1,306 @@
+#ifndef QUICK_CPPKG_DEPBUILD_HPP
+#define QUICK_CPPKG_DEPBUILD_HPP
+
+#include "cache.hpp"
+#include "hash.hpp"
+#include "lockfile.hpp"
+#include "process.hpp"
+#include "scheduler.hpp"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+    #include <process.h>
+#else
+    #include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// Builds packages that ship sources (a "build" recipe in the registry) into
+// a prefix shared by every project on the machine:
+//
+//   <cache dir>/prefix/<name>-<version>-<key>/{include,lib,...}
+//
+// The key covers the package, its archive hash, the recipe, the compiler
+// identity, the C++ standard and the keys of its own dependencies, so a
+// prefix is built once per configuration and then reused by every
+// downstream build. Packages are built in dependency order, with
+// independent packages built in parallel. Each build works and installs
+// in directories of its own and publishes the prefix with one rename, so
+// projects building the same package at the same time never mix trees.
+class DependencyBuilder {
+public:
+    DependencyBuilder(std::string compiler, std::string compiler_version, std::string cpp_version, size_t jobs)
+        : compiler_(std::move(compiler)), compiler_version_(std::move(compiler_version)),
+          cpp_version_(std::move(cpp_version)), jobs_(jobs) {}
+
+    static fs::path prefixRoot() {
+        return CompileCache::defaultDirectory() / "prefix";
+    }
+
+    // Returns name -> prefix for every source package in `lock`, building
+    // the ones that are missing. Throws std::runtime_error on failure.
+    std::map<std::string, std::string> build(const Lockfile& lock) {
+        lock_ = &lock;
+        keys_.clear();
+
+        std::map<std::string, std::string> prefixes;
+        for (const auto& [name, release] : lock.packages) {
+            if (!release.build_system.empty()) prefixes[name] = prefixFor(name);
+        }
+
+        JobScheduler scheduler(jobs_);
+        std::map<std::string, size_t> scheduled;
+        for (const auto& [name, prefix] : prefixes) {
+            schedule(name, prefixes, scheduler, scheduled);
+        }
+
+        if (!scheduled.empty()) {
+            std::cout << "🏗️  Building " << scheduled.size() << " package(s) from source" << std::endl;
+            if (!scheduler.run()) {
+                throw std::runtime_error("Failed to build dependencies from source");
+            }
+        }
+        return prefixes;
+    }
+
+private:
+    std::string compiler_;
+    std::string compiler_version_;
+    std::string cpp_version_;
+    size_t jobs_;
+    const Lockfile* lock_ = nullptr;
+    std::map<std::string, std::string> keys_;
+
+    static constexpr const char* kComplete = ".cppkg-complete";
+
+    std::string key(const std::string& name) {
+        auto cached = keys_.find(name);
+        if (cached != keys_.end()) return cached->second;
+
+        const PackageRelease& release = lock_->packages.at(name);
+        Sha256 hasher;
+        hasher.field(name).field(release.version.toString()).field(release.sha256);
+        hasher.field(release.build_system);
+        for (const auto& option : release.build_options) hasher.field(option);
+        hasher.field(compiler_).field(compiler_version_).field(cpp_version_);
+        for (const auto& [dep, constraint] : release.dependencies) {
+            if (lock_->packages.count(dep)) hasher.field(dep).field(key(dep));
+        }
+
+        return keys_[name] = hasher.hexdigest();
+    }
+
+    std::string prefixFor(const std::string& name) {
+        const PackageRelease& release = lock_->packages.at(name);
+        return (prefixRoot() / (name + "-" + release.version.toString() + "-" + key(name).substr(0, 16))).string();
+    }
+
+    // Adds `name` after the packages it depends on; returns its job id, or
+    // nothing if its prefix already exists.
+    std::optional<size_t> schedule(const std::string& name, const std::map<std::string, std::string>& prefixes,
+                                   JobScheduler& scheduler, std::map<std::string, size_t>& scheduled) {
+        auto done = scheduled.find(name);
+        if (done != scheduled.end()) return done->second;
+
+        auto prefix = prefixes.find(name);
+        if (prefix == prefixes.end() || fs::exists(prefix->second + "/" + kComplete)) return std::nullopt;
+
+        const PackageRelease& release = lock_->packages.at(name);
+        std::vector<size_t> after;
+        std::vector<std::string> dependency_roots;
+        for (const auto& [dep, constraint] : release.dependencies) {
+            auto locked = lock_->packages.find(dep);
+            if (locked == lock_->packages.end()) continue;
+
+            if (auto id = schedule(dep, prefixes, scheduler, scheduled)) after.push_back(*id);
+            auto dep_prefix = prefixes.find(dep);
+            dependency_roots.push_back(dep_prefix != prefixes.end()
+                ? dep_prefix->second
+                : fs::absolute(packageDirectory(dep, locked->second.version.toString())).string());
+        }
+
+        std::string target = prefix->second;
+        size_t id = scheduler.add([this, release, target, dependency_roots]() {
+            return buildPackage(release, target, dependency_roots);
+        }, after);
+        scheduled[name] = id;
+        return id;
+    }
+
+    JobResult buildPackage(const PackageRelease& release, const std::string& prefix,
+                           const std::vector<std::string>& dependency_roots) {
+        JobResult job;
+        std::string label = release.name + "@" + release.version.toString();
+        std::string source = fs::absolute(packageDirectory(release.name, release.version.toString())).string();
+        std::string staging = prefix + ".staging-" + processId();
+        std::string work = prefix + ".build-" + processId();
+
+        std::error_code ec;
+        fs::remove_all(staging, ec);
+        fs::create_directories(staging, ec);
+
+        std::string log;
+        bool ok = false;
+        if (release.build_system == "cmake") {
+            ok = buildWithCMake(release, source, work, staging, dependency_roots, log);
+        } else if (release.build_system == "cppkg") {
+            ok = buildNative(release, source, work, staging, dependency_roots, log);
+        } else {
+            log = "unknown build system '" + release.build_system + "'\n";
+        }
+
+        fs::remove_all(work, ec);
+        if (ok) {
+            std::ofstream(staging + "/" + kComplete) << label << "\n";
+            ok = publish(staging, prefix, log);
+        }
+
+        if (!ok) {
+            fs::remove_all(staging, ec);
+            job.ok = false;
+            job.output = "❌ Failed to build " + label + " from source\n" + log;
+            return job;
+        }
+
+        job.output = "✅ Built " + label + " into " + prefix + "\n";
+        return job;
+    }
+
+    // Moves a finished staging tree into place. Another build may have
+    // published the same prefix first; its tree is as good as ours, which
+    // is then dropped. An unfinished prefix (from an older cppkg) is moved
+    // aside before it is removed, so a finished one is never deleted.
+    static bool publish(const std::string& staging, const std::string& prefix, std::string& log) {
+        const std::string complete = prefix + "/" + kComplete;
+        std::error_code error;
+        for (int attempt = 0; attempt < 3; ++attempt) {
+            std::error_code ec;
+            if (fs::exists(complete, ec)) {
+                fs::remove_all(staging, ec);
+                return true;
+            }
+            fs::rename(staging, prefix, error);
+            if (!error) return true;
+            if (fs::exists(prefix, ec) && !fs::exists(complete, ec)) {
+                std::string stale = prefix + ".stale-" + processId();
+                fs::rename(prefix, stale, ec);
+                fs::remove_all(stale, ec);
+            }
+        }
+        log += "cannot install into " + prefix + ": " + error.message() + "\n";
+        return false;
+    }
+
+    static std::string processId() {
+    #ifdef _WIN32
+        return std::to_string(_getpid());
+    #else
+        return std::to_string(getpid());
+    #endif
+    }
+
+    std::string standardNumber() const {
+        size_t plus = cpp_version_.find("++");
+        return plus == std::string::npos ? cpp_version_ : cpp_version_.substr(plus + 2);
+    }
+
+    size_t parallelism() const {
+        return jobs_ ? jobs_ : std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    bool buildWithCMake(const PackageRelease& release, const std::string& source, const std::string& work,
+                        const std::string& staging, const std::vector<std::string>& dependency_roots, std::string& log) {
+        std::string prefix_path;
+        for (const auto& root : dependency_roots) {
+            prefix_path += (prefix_path.empty() ? "" : ";") + root;
+        }
+
+        std::vector<std::string> configure = {
+            "cmake", "-S", source, "-B", work,
+            "-DCMAKE_BUILD_TYPE=Release",
+            "-DCMAKE_INSTALL_PREFIX=" + staging,
+            "-DCMAKE_CXX_COMPILER=" + compiler_,
+            "-DCMAKE_CXX_STANDARD=" + standardNumber(),
+            "-DCMAKE_POSITION_INDEPENDENT_CODE=ON",
+            "-DCMAKE_PREFIX_PATH=" + prefix_path
+        };
+        configure.insert(configure.end(), release.build_options.begin(), release.build_options.end());
+
+        for (const auto& cmd : std::vector<std::vector<std::string>>{
+                 configure,
+                 {"cmake", "--build", work, "--parallel", std::to_string(parallelism())},
+                 {"cmake", "--install", work}}) {
+            ProcessResult result = runProcess(cmd);
+            if (result.exit_code != 0) {
+                log += formatCommand(cmd) + "\n" + result.output;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The cppkg layout: every .cpp under src/ goes into lib/lib<name>.a and
+    // include/ is installed as-is.
+    bool buildNative(const PackageRelease& release, const std::string& source, const std::string& work,
+                     const std::string& staging, const std::vector<std::string>& dependency_roots, std::string& log) {
+        if (compiler_ == "cl") {
+            log = "cppkg-native recipes need g++ or clang++\n";
+            return false;
+        }
+
+        std::error_code ec;
+        fs::create_directories(work, ec);
+        fs::create_directories(staging + "/lib", ec);
+
+        std::vector<std::string> flags = {compiler_, "-std=" + cpp_version_, "-O2", "-fPIC", "-I" + source + "/include"};
+        for (const auto& root : dependency_roots) {
+            flags.push_back("-I" + root + "/include");
+        }
+        flags.insert(flags.end(), release.build_options.begin(), release.build_options.end());
+
+        std::vector<std::string> archive = {"ar", "rcs", staging + "/lib/lib" + release.name + ".a"};
+        size_t index = 0;
+        for (const auto& entry : fs::recursive_directory_iterator(source + "/src", ec)) {
+            if (entry.path().extension() != ".cpp") continue;
+
+            std::string object = work + "/" + std::to_string(index++) + ".o";
+            std::vector<std::string> cmd = flags;
+            cmd.insert(cmd.end(), {"-c", entry.path().string(), "-o", object});
+
+            ProcessResult result = runProcess(cmd);
+            if (result.exit_code != 0) {
+                log += formatCommand(cmd) + "\n" + result.output;
+                return false;
+            }
+            archive.push_back(object);
+        }
+
+        if (index > 0) {
+            ProcessResult result = runProcess(archive);
+            if (result.exit_code != 0) {
+                log += formatCommand(archive) + "\n" + result.output;
+                return false;
+            }
+        }
+
+        if (fs::exists(source + "/include")) {
+            fs::copy(source + "/include", staging + "/include", fs::copy_options::recursive, ec);
+            if (ec) {
+                log += ec.message() + "\n";
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+#endif
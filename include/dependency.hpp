@@ -8,7 +8,7 @@ struct Dependency {
     std::string version;
     std::string include_path;
     std::string library_path;
-    std::string type; // header-only / static / dynamic
+    std::string type; // header-only / static / shared
 };
 
 #endif
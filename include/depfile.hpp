@@ -0,0 +1,92 @@
+#ifndef QUICK_CPPKG_DEPFILE_HPP
+#define QUICK_CPPKG_DEPFILE_HPP
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Reads a make-style dependency file as written by `-MMD -MF <file>` and
+// returns every prerequisite of the first rule (the source itself included).
+inline std::vector<std::string> parseDepfile(const std::string& path) {
+    std::vector<std::string> prerequisites;
+
+    std::ifstream file(path);
+    if (!file) return prerequisites;
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string content = buffer.str();
+
+    size_t pos = 0;
+    bool in_targets = true;
+    std::string current;
+
+    auto flush = [&]() {
+        if (!current.empty()) {
+            if (!in_targets) prerequisites.push_back(current);
+            current.clear();
+        }
+    };
+
+    while (pos < content.size()) {
+        char c = content[pos];
+
+        if (c == '\\' && pos + 1 < content.size()) {
+            char next = content[pos + 1];
+            if (next == '\n') {
+                flush();
+                pos += 2;
+                continue;
+            }
+            if (next == '\r' && pos + 2 < content.size() && content[pos + 2] == '\n') {
+                flush();
+                pos += 3;
+                continue;
+            }
+            if (next == ' ' || next == '#' || next == '\\') {
+                current += next;
+                pos += 2;
+                continue;
+            }
+        }
+
+        if (c == '$' && pos + 1 < content.size() && content[pos + 1] == '$') {
+            current += '$';
+            pos += 2;
+            continue;
+        }
+
+        if (in_targets && c == ':' && (pos + 1 >= content.size() ||
+                                       content[pos + 1] == ' ' ||
+                                       content[pos + 1] == '\n' ||
+                                       content[pos + 1] == '\r')) {
+            current.clear();
+            in_targets = false;
+            ++pos;
+            continue;
+        }
+
+        if (c == '\n') {
+            flush();
+            // Only the first rule matters; -MP phony targets follow it.
+            if (!in_targets) break;
+            ++pos;
+            continue;
+        }
+
+        if (c == ' ' || c == '\t' || c == '\r') {
+            flush();
+            ++pos;
+            continue;
+        }
+
+        current += c;
+        ++pos;
+    }
+
+    flush();
+    return prerequisites;
+}
+
+#endif
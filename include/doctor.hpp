@@ -0,0 +1,126 @@
+#ifndef QUICK_CPPKG_DOCTOR_HPP
+#define QUICK_CPPKG_DOCTOR_HPP
+
+#include "command.hpp"
+#include "includes.hpp"
+#include "nlohmann/json.hpp"
+#include "pch.hpp"
+#include "state.hpp"
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+// `cppkg doctor includes`: which include directories the last build of a
+// profile actually needed. A directory counts as used when some header the
+// depfiles list lies under it at a path that an #include in one of those
+// files spells out. Quoted includes that resolve next to the including file
+// are counted too, so the report errs on the side of keeping a directory.
+class DoctorHandler : public CommandHandler {
+public:
+    DoctorHandler(std::string action, std::string profile) : action_(std::move(action)), profile_(std::move(profile)) {}
+
+    void execute() override {
+        if (action_ == "includes") {
+            reportIncludes();
+        }
+    }
+
+private:
+    std::string action_;
+    std::string profile_;
+
+    void reportIncludes() {
+        json config = json::parse(std::ifstream("cppkg.json"));
+
+        std::string state_path = "build/" + profile_ + "/.cppkg_state";
+        BuildState state;
+        if (!state.load(state_path) || state.steps.empty()) {
+            throw std::runtime_error("No build state in " + state_path + "; run `cppkg build --profile " + profile_ + "` first");
+        }
+
+        // Link records list objects and libraries, not sources.
+        std::set<std::string> prerequisites;
+        size_t steps = 0;
+        for (const auto& [object, record] : state.steps) {
+            std::string extension = fs::path(object).extension().string();
+            if (extension != ".o" && extension != ".gch" && extension != ".pch") continue;
+            ++steps;
+            for (const auto& prerequisite : record.prerequisites) {
+                fs::path path = fs::path(prerequisite.path).lexically_normal();
+                if (path.is_relative()) prerequisites.insert(path.generic_string());
+            }
+        }
+
+        std::set<std::string> spellings;
+        for (const auto& path : prerequisites) {
+            for (const auto& include : scanIncludes(path)) {
+                spellings.insert(fs::path(include).lexically_normal().generic_string());
+            }
+        }
+
+        std::vector<std::string> scanned = headerDirectories(scanTree(".", state));
+        IncludeDirs declared = declaredIncludeDirs(config);
+        if (config.contains("targets")) {
+            for (const auto& [name, target] : config["targets"].items()) {
+                if (!target.contains("include_dirs")) continue;
+                IncludeDirs dirs = IncludeDirs::parse(target["include_dirs"]);
+                declared.public_dirs.insert(declared.public_dirs.end(), dirs.public_dirs.begin(), dirs.public_dirs.end());
+                declared.private_dirs.insert(declared.private_dirs.end(), dirs.private_dirs.begin(), dirs.private_dirs.end());
+            }
+        }
+
+        std::set<std::string> candidates(scanned.begin(), scanned.end());
+        for (const auto& dir : declared.all()) {
+            candidates.insert(fs::path(dir).lexically_normal().generic_string());
+        }
+
+        std::map<std::string, size_t> used;
+        for (const auto& dir : candidates) {
+            size_t count = 0;
+            for (const auto& path : prerequisites) {
+                std::string relative = dir == "." ? path : fs::path(path).lexically_relative(dir).generic_string();
+                if (!relative.empty() && relative.rfind("..", 0) != 0 && spellings.count(relative)) ++count;
+            }
+            used[dir] = count;
+        }
+
+        std::cout << "Include directories used by the last " << profile_ << " build ("
+                  << steps << " step(s)):\n";
+        for (const auto& [dir, count] : used) {
+            std::cout << "  " << (count ? "used  " : "unused") << std::setw(6)
+                      << (count ? std::to_string(count) : "") << "  " << dir << "\n";
+        }
+
+        std::vector<std::string> needed;
+        for (const auto& dir : scanned) {
+            if (used[dir]) needed.push_back(dir);
+        }
+
+        if (declared.declared()) {
+            for (const auto& dir : declared.all()) {
+                if (!used[fs::path(dir).lexically_normal().generic_string()]) {
+                    std::cout << "Declared include_dirs entry '" << dir << "' is never used\n";
+                }
+            }
+            return;
+        }
+
+        std::cout << needed.size() << " of " << scanned.size() << " scanned directories are used.";
+        if (needed.size() < scanned.size()) {
+            std::cout << " Declaring them in cppkg.json drops " << scanned.size() - needed.size() << " -I flag(s):\n"
+                      << "  \"include_dirs\": " << json(needed).dump();
+        }
+        std::cout << "\n";
+    }
+};
+
+#endif
@@ -0,0 +1,194 @@
+#ifndef QUICK_CPPKG_FETCH_HPP
+#define QUICK_CPPKG_FETCH_HPP
+
+#include "hash.hpp"
+#include "lockfile.hpp"
+#include "process.hpp"
+#include "scheduler.hpp"
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Populates _packages/<name>/<version>/ for every package in a lock.
+//
+// Archives are downloaded into _packages/.downloads/ as <file>.part, hashed
+// while they stream in, and renamed once complete. An interrupted download
+// resumes from the bytes already on disk. Unpacking is delegated to `tar`,
+// which decompresses straight to disk. A package directory carries a
+// .cppkg-sha256 marker naming the archive it was unpacked from, so a
+// package that is already in place costs a single small file read.
+class PackageFetcher {
+public:
+    explicit PackageFetcher(size_t jobs) : jobs_(jobs) {}
+
+    bool fetch(const Lockfile& lock) {
+        JobScheduler scheduler(jobs_);
+        size_t queued = 0;
+
+        for (const auto& [name, release] : lock.packages) {
+            if (isInstalled(release)) continue;
+
+            scheduler.add([this, release]() { return install(release); });
+            ++queued;
+        }
+
+        if (queued == 0) return true;
+
+        std::cout << "📥 Fetching " << queued << " package(s)" << std::endl;
+        return scheduler.run();
+    }
+
+private:
+    size_t jobs_;
+
+    static constexpr const char* kDownloads = "_packages/.downloads";
+    static constexpr const char* kMarker = ".cppkg-sha256";
+
+    static std::string directory(const PackageRelease& release) {
+        return packageDirectory(release.name, release.version.toString());
+    }
+
+    static bool isInstalled(const PackageRelease& release) {
+        std::ifstream marker(directory(release) + "/" + kMarker);
+        std::string hash;
+        return marker && std::getline(marker, hash) && hash == release.sha256;
+    }
+
+    static std::string archiveName(const PackageRelease& release) {
+        std::string file = fs::path(release.url).filename().string();
+        if (file.empty()) file = release.name + "-" + release.version.toString() + ".tar.gz";
+        return release.name + "-" + release.version.toString() + "-" + file;
+    }
+
+    JobResult install(const PackageRelease& release) {
+        JobResult job;
+        std::string label = release.name + "@" + release.version.toString();
+
+        std::error_code ec;
+        fs::create_directories(kDownloads, ec);
+        std::string archive = std::string(kDownloads) + "/" + archiveName(release);
+
+        std::string error;
+        std::string hash = download(release.url, archive, error);
+        if (!error.empty()) {
+            job.ok = false;
+            job.output = "❌ Failed to download " + label + ": " + error + "\n";
+            return job;
+        }
+
+        if (!release.sha256.empty() && hash != release.sha256) {
+            fs::remove(archive, ec);
+            job.ok = false;
+            job.output = "❌ Hash mismatch for " + label + "\n   expected " + release.sha256 +
+                         "\n   got      " + hash + "\n";
+            return job;
+        }
+
+        if (!extract(archive, directory(release), error)) {
+            job.ok = false;
+            job.output = "❌ Failed to unpack " + label + ": " + error + "\n";
+            return job;
+        }
+
+        std::ofstream(directory(release) + "/" + kMarker) << release.sha256 << "\n";
+        fs::remove(archive, ec);
+
+        job.output = "✅ Fetched " + label + (release.sha256.empty() ? " (unverified: no sha256 in lock)" : "") + "\n";
+        return job;
+    }
+
+    // Returns the SHA-256 of the completed archive, or sets `error`.
+    static std::string download(const std::string& url, const std::string& archive, std::string& error) {
+        std::string part = archive + ".part";
+        std::error_code ec;
+
+        if (url.rfind("http://", 0) == 0 || url.rfind("https://", 0) == 0) {
+            // curl continues a partial file in place with -C -.
+            ProcessResult result = runProcess({"curl", "-fsSL", "--retry", "2", "-C", "-", "-o", part, url});
+            if (result.exit_code != 0) {
+                error = result.output.empty() ? "curl exited with " + std::to_string(result.exit_code) : result.output;
+                return "";
+            }
+            fs::rename(part, archive, ec);
+            return sha256File(archive);
+        }
+
+        std::string source = url.rfind("file://", 0) == 0 ? url.substr(7) : url;
+        std::ifstream in(source, std::ios::binary);
+        if (!in) {
+            error = "cannot open " + source;
+            return "";
+        }
+
+        // Resume: re-hash what is already on disk and continue after it.
+        Sha256 hasher;
+        uint64_t have = fs::exists(part) ? fs::file_size(part, ec) : 0;
+        uint64_t total = fs::file_size(source, ec);
+        if (ec || have > total) {
+            fs::remove(part, ec);
+            have = 0;
+        }
+
+        std::vector<char> buffer(1 << 20);
+        if (have > 0) {
+            std::ifstream existing(part, std::ios::binary);
+            uint64_t left = have;
+            while (left > 0 && existing.read(buffer.data(), static_cast<std::streamsize>(std::min<uint64_t>(left, buffer.size())))) {
+                hasher.update(buffer.data(), static_cast<size_t>(existing.gcount()));
+                left -= static_cast<uint64_t>(existing.gcount());
+            }
+            in.seekg(static_cast<std::streamoff>(have));
+        }
+
+        std::ofstream out(part, std::ios::binary | std::ios::app);
+        while (in.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || in.gcount() > 0) {
+            out.write(buffer.data(), in.gcount());
+            hasher.update(buffer.data(), static_cast<size_t>(in.gcount()));
+        }
+        out.close();
+        if (!out) {
+            error = "write error on " + part;
+            return "";
+        }
+
+        fs::rename(part, archive, ec);
+        return hasher.hexdigest();
+    }
+
+    // Unpacks into a scratch directory first so a failed extraction never
+    // leaves a half-populated package behind. A single top-level directory
+    // in the archive (e.g. fmt-9.1.0/) is stripped.
+    static bool extract(const std::string& archive, const std::string& destination, std::string& error) {
+        std::error_code ec;
+        std::string scratch = destination + ".extracting";
+        fs::remove_all(scratch, ec);
+        fs::create_directories(scratch, ec);
+
+        ProcessResult result = runProcess({"tar", "-xf", archive, "-C", scratch});
+        if (result.exit_code != 0) {
+            error = result.output.empty() ? "tar exited with " + std::to_string(result.exit_code) : result.output;
+            fs::remove_all(scratch, ec);
+            return false;
+        }
+
+        std::vector<fs::directory_entry> top;
+        for (const auto& entry : fs::directory_iterator(scratch, ec)) {
+            top.push_back(entry);
+        }
+        fs::path root = top.size() == 1 && top[0].is_directory() ? top[0].path() : fs::path(scratch);
+
+        fs::remove_all(destination, ec);
+        fs::create_directories(fs::path(destination).parent_path(), ec);
+        fs::rename(root, destination, ec);
+        if (ec) {
+            error = ec.message();
+        }
+        fs::remove_all(scratch, ec);
+        return error.empty();
+    }
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef QUICK_CPPKG_INCLUDES_HPP
+#define QUICK_CPPKG_INCLUDES_HPP
+
+#include "nlohmann/json.hpp"
+#include <filesystem>
+#include <set>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+inline bool isHeaderFile(const fs::path& path) {
+    static const std::unordered_set<std::string> extensions = {".h", ".hpp", ".hh", ".hxx"};
+    return extensions.count(path.extension().string()) > 0;
+}
+
+// Every directory of `files` that directly contains a header, normalized
+// and sorted. This is the fallback include path when none is declared.
+inline std::vector<std::string> headerDirectories(const std::vector<std::string>& files) {
+    std::set<std::string> directories;
+    for (const auto& file : files) {
+        fs::path path(file);
+        if (isHeaderFile(path)) {
+            std::string directory = path.parent_path().lexically_normal().generic_string();
+            directories.insert(directory.empty() ? "." : directory);
+        }
+    }
+    return {directories.begin(), directories.end()};
+}
+
+// "include_dirs" of cppkg.json, either a list (all public) or
+//
+//   "include_dirs": {"public": ["include"], "private": ["src"]}
+//
+// Public directories are also seen by whatever depends on the project;
+// private ones only by its own sources.
+struct IncludeDirs {
+    std::vector<std::string> public_dirs;
+    std::vector<std::string> private_dirs;
+
+    bool declared() const { return !public_dirs.empty() || !private_dirs.empty(); }
+
+    std::vector<std::string> all() const {
+        std::vector<std::string> result = public_dirs;
+        result.insert(result.end(), private_dirs.begin(), private_dirs.end());
+        return result;
+    }
+
+    static IncludeDirs parse(const json& entry) {
+        IncludeDirs dirs;
+        if (entry.is_array()) {
+            dirs.public_dirs = entry.get<std::vector<std::string>>();
+        } else if (entry.is_object()) {
+            dirs.public_dirs = entry.value("public", std::vector<std::string>{});
+            dirs.private_dirs = entry.value("private", std::vector<std::string>{});
+        }
+        return dirs;
+    }
+};
+
+inline IncludeDirs declaredIncludeDirs(const json& config) {
+    return config.contains("include_dirs") ? IncludeDirs::parse(config["include_dirs"]) : IncludeDirs{};
+}
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef QUICK_CPPKG_LOCKFILE_HPP
+#define QUICK_CPPKG_LOCKFILE_HPP
+
+#include "dependency.hpp"
+#include "nlohmann/json.hpp"
+#include "registry.hpp"
+#include "resolver.hpp"
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+inline std::string packageDirectory(const std::string& name, const std::string& version) {
+    return "_packages/" + name + "/" + version;
+}
+
+// cppkg.lock: the exact release chosen for every package in the graph, plus
+// the top-level constraints it was resolved from so a stale lock can be
+// detected after cppkg.json is edited by hand.
+struct Lockfile {
+    std::map<std::string, std::string> requirements;
+    std::map<std::string, PackageRelease> packages;
+
+    static std::optional<Lockfile> load(const std::string& path = "cppkg.lock") {
+        std::ifstream file(path);
+        if (!file) return std::nullopt;
+
+        json data;
+        try {
+            data = json::parse(file);
+        } catch (const json::parse_error&) {
+            return std::nullopt;
+        }
+
+        Lockfile lock;
+        lock.requirements = data.value("requires", std::map<std::string, std::string>{});
+        const json packages = data.value("packages", json::object());
+        for (const auto& [name, entry] : packages.items()) {
+            auto version = Version::parse(entry.value("version", ""));
+            if (!version) return std::nullopt;
+
+            PackageRelease release;
+            release.name = name;
+            release.version = *version;
+            release.url = entry.value("url", "");
+            release.sha256 = entry.value("sha256", "");
+            release.type = entry.value("type", "header-only");
+            release.include_dir = entry.value("include", "include");
+            release.library = entry.value("library", "");
+            release.dependencies = entry.value("dependencies", std::map<std::string, std::string>{});
+            readBuildRecipe(entry, release);
+            lock.packages.emplace(name, std::move(release));
+        }
+        return lock;
+    }
+
+    bool save(const std::string& path = "cppkg.lock") const {
+        nlohmann::ordered_json data;
+        data["version"] = 1;
+        data["requires"] = requirements;
+        data["packages"] = nlohmann::ordered_json::object();
+
+        for (const auto& [name, release] : packages) {
+            data["packages"][name] = {
+                {"version", release.version.toString()},
+                {"url", release.url},
+                {"sha256", release.sha256},
+                {"type", release.type},
+                {"include", release.include_dir},
+                {"library", release.library},
+                {"dependencies", release.dependencies}
+            };
+            if (!release.build_system.empty()) {
+                data["packages"][name]["build"] = {
+                    {"system", release.build_system},
+                    {"options", release.build_options}
+                };
+            }
+        }
+
+        std::ofstream file(path);
+        if (!file) return false;
+        file << data.dump(2) << "\n";
+        return true;
+    }
+
+    bool isCurrent(const std::map<std::string, std::string>& wanted) const {
+        return requirements == wanted;
+    }
+
+    // `prefixes` maps source-built packages to the prefix they were installed
+    // into; every other package is used straight from _packages/.
+    std::vector<Dependency> dependencies(const std::map<std::string, std::string>& prefixes = {}) const {
+        std::vector<Dependency> result;
+        for (const auto& [name, release] : packages) {
+            auto prefix = prefixes.find(name);
+            std::string root = prefix != prefixes.end() ? prefix->second : packageDirectory(name, release.version.toString());
+            result.push_back({
+                name,
+                release.version.toString(),
+                release.include_dir.empty() ? "" : root + "/" + release.include_dir,
+                release.library.empty() ? "" : root + "/" + release.library,
+                release.type
+            });
+        }
+        return result;
+    }
+};
+
+// The "dependencies" object of cppkg.json as name -> constraint.
+template <typename Json>
+std::map<std::string, std::string> declaredDependencies(const Json& config) {
+    std::map<std::string, std::string> declared;
+    if (config.contains("dependencies") && config["dependencies"].is_object()) {
+        for (const auto& [name, constraint] : config["dependencies"].items()) {
+            declared[name] = constraint.is_string() ? constraint.template get<std::string>() : "*";
+        }
+    }
+    return declared;
+}
+
+// Resolves `declared` against the registry and returns the resulting lock.
+inline Lockfile resolveLockfile(Registry& registry, const std::map<std::string, std::string>& declared) {
+    Resolver resolver(registry);
+
+    Lockfile lock;
+    lock.requirements = declared;
+    for (const auto& [name, release] : resolver.resolve(declared)) {
+        PackageRelease locked = *release;
+        locked.url = registry.resolveUrl(release->url);
+        lock.packages.emplace(name, std::move(locked));
+    }
+    return lock;
+}
+
+#endif
@@ -0,0 +1,214 @@
+#ifndef QUICK_CPPKG_MODULES_HPP
+#define QUICK_CPPKG_MODULES_HPP
+
+#include "nlohmann/json.hpp"
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+// What a translation unit contributes to the module graph.
+struct ModuleUnit {
+    std::string name;                 // module named by the unit's module declaration, "" if it has none
+    std::string provides;             // module or partition whose BMI the unit produces, e.g. "math:ops"
+    bool interface = false;           // `export module`, as opposed to an internal partition
+    std::vector<std::string> imports; // named modules and partitions it imports
+
+    bool empty() const { return name.empty() && provides.empty() && imports.empty(); }
+
+    json toJson() const {
+        return {{"name", name}, {"provides", provides}, {"interface", interface}, {"imports", imports}};
+    }
+
+    static ModuleUnit fromJson(const json& entry) {
+        ModuleUnit unit;
+        unit.name = entry.value("name", "");
+        unit.provides = entry.value("provides", "");
+        unit.interface = entry.value("interface", false);
+        unit.imports = entry.value("imports", std::vector<std::string>{});
+        return unit;
+    }
+};
+
+inline bool isModuleInterfaceFile(const fs::path& path) {
+    std::string extension = path.extension().string();
+    return extension == ".cppm" || extension == ".ixx";
+}
+
+// Named modules need C++20: "c++20", "gnu++2b", "c++latest"...
+inline bool standardHasModules(const std::string& standard) {
+    auto pos = standard.rfind("++");
+    if (pos == std::string::npos) return false;
+    std::string level = standard.substr(pos + 2);
+    return level == "latest" || (level.size() == 2 && level[0] == '2');
+}
+
+// The BMI file of a module; partitions use the "module-partition" names
+// clang's -fprebuilt-module-path and cl's /ifcSearchDir look for.
+inline std::string bmiFileName(const std::string& module, const std::string& extension) {
+    std::string name = module;
+    for (char& c : name) {
+        if (c == ':') c = '-';
+    }
+    return name + extension;
+}
+
+// Finds module declarations and imports without preprocessing: comments,
+// literals and preprocessor lines are skipped, and `[export] module` or
+// `[export] import` starting a declaration is read up to its ';'. Imports
+// that only appear through macros or #if branches are not seen; header
+// units (`import <vector>;`) are left to the compiler.
+inline ModuleUnit scanModuleSource(const std::string& path) {
+    ModuleUnit unit;
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return unit;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string text = buffer.str();
+
+    // Identifiers, and every other non-blank character on its own.
+    std::vector<std::string> tokens;
+    size_t i = 0;
+    bool line_start = true;
+    while (i < text.size()) {
+        char c = text[i];
+        if (c == '\n') {
+            line_start = true;
+            ++i;
+        } else if (std::isspace(static_cast<unsigned char>(c))) {
+            ++i;
+        } else if (c == '#' && line_start) {
+            while (i < text.size() && text[i] != '\n') {
+                if (text[i] == '\\' && i + 1 < text.size() && text[i + 1] == '\n') ++i;
+                ++i;
+            }
+        } else if (text.compare(i, 2, "//") == 0) {
+            while (i < text.size() && text[i] != '\n') ++i;
+        } else if (text.compare(i, 2, "/*") == 0) {
+            size_t end = text.find("*/", i + 2);
+            i = end == std::string::npos ? text.size() : end + 2;
+        } else if (c == 'R' && i + 1 < text.size() && text[i + 1] == '"') {
+            size_t open = text.find('(', i + 2);
+            if (open == std::string::npos) break;
+            std::string close = ")" + text.substr(i + 2, open - i - 2) + "\"";
+            size_t end = text.find(close, open);
+            i = end == std::string::npos ? text.size() : end + close.size();
+            line_start = false;
+        } else if (c == '"' || c == '\'') {
+            ++i;
+            while (i < text.size() && text[i] != c && text[i] != '\n') {
+                i += text[i] == '\\' ? 2 : 1;
+            }
+            ++i;
+            tokens.push_back(std::string(1, c));
+            line_start = false;
+        } else if (std::isalnum(static_cast<unsigned char>(c)) || c == '_') {
+            size_t begin = i;
+            while (i < text.size() && (std::isalnum(static_cast<unsigned char>(text[i])) || text[i] == '_')) ++i;
+            tokens.push_back(text.substr(begin, i - begin));
+            line_start = false;
+        } else {
+            tokens.push_back(std::string(1, c));
+            ++i;
+            line_start = false;
+        }
+    }
+
+    auto isIdentifier = [](const std::string& token) {
+        return !token.empty() && (std::isalpha(static_cast<unsigned char>(token[0])) || token[0] == '_');
+    };
+    // A dotted module name starting at tokens[k], or "" if there is none.
+    auto readName = [&](size_t& k) {
+        std::string name;
+        while (k < tokens.size() && isIdentifier(tokens[k])) {
+            name += tokens[k++];
+            if (k + 1 < tokens.size() && tokens[k] == "." && isIdentifier(tokens[k + 1])) {
+                name += tokens[k++];
+            } else {
+                break;
+            }
+        }
+        return name;
+    };
+
+    std::string primary; // the module this unit belongs to
+    bool statement_start = true;
+    for (size_t k = 0; k < tokens.size(); ++k) {
+        const std::string& token = tokens[k];
+        if (!statement_start) {
+            statement_start = token == ";" || token == "{" || token == "}";
+            continue;
+        }
+
+        size_t j = k;
+        bool exported = tokens[j] == "export";
+        if (exported) ++j;
+        if (j >= tokens.size() || (tokens[j] != "module" && tokens[j] != "import")) {
+            statement_start = token == ";" || token == "{" || token == "}";
+            continue;
+        }
+        bool declaration = tokens[j] == "module";
+        ++j;
+
+        std::string name = readName(j);
+        std::string partition;
+        if (j + 1 < tokens.size() && tokens[j] == ":" && isIdentifier(tokens[j + 1])) {
+            ++j;
+            partition = readName(j);
+        }
+        // `module;`, `module :private;`, `import <header>;` and anything
+        // that merely uses the words as identifiers.
+        if ((name.empty() && partition.empty()) || (declaration && name.empty()) ||
+            j >= tokens.size() || (tokens[j] != ";" && tokens[j] != "[")) {
+            statement_start = token == ";" || token == "{" || token == "}";
+            continue;
+        }
+
+        if (declaration) {
+            primary = unit.name = name;
+            if (exported || !partition.empty()) {
+                unit.provides = partition.empty() ? name : name + ":" + partition;
+                unit.interface = exported;
+            } else {
+                // Implementation units implicitly import their interface.
+                unit.imports.push_back(name);
+            }
+        } else if (name.empty()) {
+            unit.imports.push_back(primary + ":" + partition);
+        } else {
+            unit.imports.push_back(name);
+        }
+        k = j;
+        while (k < tokens.size() && tokens[k] != ";") ++k;
+        statement_start = true;
+    }
+    return unit;
+}
+
+// The first rule of a P1689 dependency file, as written by clang-scan-deps
+// -format=p1689, g++ -fdeps-format=p1689r5 and cl /scanDependencies. It has
+// no module declaration of its own; `name` is left empty.
+inline ModuleUnit parseP1689(const json& document) {
+    ModuleUnit unit;
+    if (!document.contains("rules") || !document["rules"].is_array() || document["rules"].empty()) return unit;
+
+    const json& rule = document["rules"][0];
+    for (const auto& provided : rule.value("provides", json::array())) {
+        unit.provides = provided.value("logical-name", "");
+        unit.interface = provided.value("is-interface", true);
+    }
+    for (const auto& required : rule.value("requires", json::array())) {
+        // Header units are found by the compiler through the include path.
+        std::string lookup = required.value("lookup-method", "by-name");
+        if (lookup != "by-name") continue;
+        unit.imports.push_back(required.value("logical-name", ""));
+    }
+    return unit;
+}
+
+#endif
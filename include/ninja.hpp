@@ -0,0 +1,91 @@
+#ifndef QUICK_CPPKG_NINJA_HPP
+#define QUICK_CPPKG_NINJA_HPP
+
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Variable values only need "$" escaped; paths in build lines also need
+// spaces and colons, which would otherwise end the path.
+inline std::string ninjaEscape(const std::string& value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '$') escaped += '$';
+        escaped += c;
+    }
+    return escaped;
+}
+
+inline std::string ninjaEscapePath(const std::string& path) {
+    std::string escaped;
+    for (char c : path) {
+        if (c == '$' || c == ' ' || c == ':') escaped += '$';
+        escaped += c;
+    }
+    return escaped;
+}
+
+// Builds the text of a build.ninja file.
+class NinjaWriter {
+public:
+    using Variables = std::vector<std::pair<std::string, std::string>>;
+
+    void comment(const std::string& text) {
+        out_ << "# " << text << "\n";
+    }
+
+    void newline() {
+        out_ << "\n";
+    }
+
+    void variable(const std::string& name, const std::string& value, int indent = 0) {
+        out_ << std::string(indent * 2, ' ') << name << " = " << value << "\n";
+    }
+
+    // Rule variables are written as given, so they may refer to $in, $out
+    // and per-build variables.
+    void rule(const std::string& name, const Variables& variables) {
+        out_ << "rule " << name << "\n";
+        for (const auto& [key, value] : variables) {
+            variable(key, value, 1);
+        }
+        out_ << "\n";
+    }
+
+    // `variables` are escaped, since they carry literal commands and paths.
+    // `implicit_outputs` (e.g. a module's BMI) need ninja 1.7.
+    void build(const std::vector<std::string>& outputs, const std::string& rule,
+               const std::vector<std::string>& inputs, const std::vector<std::string>& implicit = {},
+               const Variables& variables = {}, const std::vector<std::string>& implicit_outputs = {}) {
+        out_ << "build";
+        for (const auto& output : outputs) out_ << " " << ninjaEscapePath(output);
+        if (!implicit_outputs.empty()) {
+            out_ << " |";
+            for (const auto& output : implicit_outputs) out_ << " " << ninjaEscapePath(output);
+        }
+        out_ << ": " << rule;
+        for (const auto& input : inputs) out_ << " " << ninjaEscapePath(input);
+        if (!implicit.empty()) {
+            out_ << " |";
+            for (const auto& input : implicit) out_ << " " << ninjaEscapePath(input);
+        }
+        out_ << "\n";
+        for (const auto& [key, value] : variables) {
+            variable(key, ninjaEscape(value), 1);
+        }
+    }
+
+    void defaults(const std::vector<std::string>& outputs) {
+        out_ << "default";
+        for (const auto& output : outputs) out_ << " " << ninjaEscapePath(output);
+        out_ << "\n";
+    }
+
+    std::string str() const { return out_.str(); }
+
+private:
+    std::ostringstream out_;
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef QUICK_CPPKG_PCH_HPP
+#define QUICK_CPPKG_PCH_HPP
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// The `#include` targets written directly in a source file, in order, as
+// they appear between the quotes or angle brackets.
+inline std::vector<std::string> scanIncludes(const std::string& path) {
+    std::vector<std::string> includes;
+    std::ifstream file(path);
+    std::string line;
+
+    while (std::getline(file, line)) {
+        size_t pos = line.find_first_not_of(" \t");
+        if (pos == std::string::npos || line[pos] != '#') continue;
+        pos = line.find_first_not_of(" \t", pos + 1);
+        if (pos == std::string::npos || line.compare(pos, 7, "include") != 0) continue;
+        pos = line.find_first_of("<\"", pos + 7);
+        if (pos == std::string::npos) continue;
+
+        char close = line[pos] == '<' ? '>' : '"';
+        size_t end = line.find(close, pos + 1);
+        if (end != std::string::npos) includes.push_back(line.substr(pos + 1, end - pos - 1));
+    }
+    return includes;
+}
+
+// Headers included directly by at least half of `sources` (and by at least
+// two of them), ordered by first appearance so the generated header keeps
+// the include order the sources use.
+inline std::vector<std::string> detectCommonHeaders(const std::vector<std::string>& sources) {
+    std::map<std::string, size_t> counts;
+    std::vector<std::string> order;
+
+    for (const auto& source : sources) {
+        std::unordered_set<std::string> seen;
+        for (const auto& header : scanIncludes(source)) {
+            // Paths relative to the including file cannot move into build/.
+            if (header.rfind(".", 0) == 0 || !seen.insert(header).second) continue;
+            if (counts[header]++ == 0) order.push_back(header);
+        }
+    }
+
+    size_t threshold = std::max<size_t>(2, (sources.size() + 1) / 2);
+    std::vector<std::string> common;
+    for (const auto& header : order) {
+        if (counts[header] >= threshold) common.push_back(header);
+    }
+    return common;
+}
+
+// The text of the generated prefix header.
+inline std::string pchSource(const std::vector<std::string>& headers) {
+    std::ostringstream out;
+    out << "// Generated by cppkg from the \"pch\" setting in cppkg.json.\n";
+    for (const auto& header : headers) {
+        out << "#include <" << header << ">\n";
+    }
+    return out.str();
+}
+
+// Rewrites `path` only when its content changes, so its mtime (and with it
+// everything that depends on the file) stays put across no-op builds.
+inline bool writeIfChanged(const std::string& path, const std::string& content) {
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (in) {
+            std::ostringstream current;
+            current << in.rdbuf();
+            if (current.str() == content) return false;
+        }
+    }
+    std::ofstream(path, std::ios::binary) << content;
+    return true;
+}
+
+#endif
@@ -0,0 +1,282 @@
+#ifndef QUICK_CPPKG_PROCESS_HPP
+#define QUICK_CPPKG_PROCESS_HPP
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+    #include <cerrno>
+    #include <csignal>
+    #include <cstring>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <spawn.h>
+    #include <sys/resource.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+    extern char** environ;
+#endif
+
+struct ProcessOptions {
+    // When false the child inherits our stdout/stderr and nothing is captured.
+    bool capture = true;
+    // Zero means no limit; on expiry the child is killed with SIGKILL.
+    std::chrono::milliseconds timeout{0};
+};
+
+struct ProcessResult {
+    int exit_code = -1; // 128 + signal number if the child was killed
+    bool timed_out = false;
+    std::string output; // stdout and stderr, interleaved as written
+    // What the child used, as wait4() reports it; left zero on Windows.
+    double user_seconds = 0;
+    double system_seconds = 0;
+    long max_rss_kb = 0;
+};
+
+// Quotes an argv vector for display (and for the shell fallback on Windows).
+inline std::string formatCommand(const std::vector<std::string>& argv) {
+    std::string cmd;
+    for (const auto& arg : argv) {
+        if (!cmd.empty()) cmd += ' ';
+
+        bool plain = !arg.empty() && arg.find_first_of(" \t\"'\\$`") == std::string::npos;
+        if (plain) {
+            cmd += arg;
+            continue;
+        }
+
+        cmd += '"';
+        for (char c : arg) {
+            if (c == '"' || c == '\\' || c == '$' || c == '`') cmd += '\\';
+            cmd += c;
+        }
+        cmd += '"';
+    }
+    return cmd;
+}
+
+#ifdef _WIN32
+
+inline ProcessResult runProcess(const std::vector<std::string>& argv, const ProcessOptions& options = {}) {
+    ProcessResult result;
+    std::string cmd = formatCommand(argv);
+
+    if (!options.capture) {
+        result.exit_code = std::system(cmd.c_str());
+        return result;
+    }
+
+    FILE* pipe = _popen((cmd + " 2>&1").c_str(), "r");
+    if (!pipe) return result;
+
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        result.output.append(buffer, n);
+    }
+    result.exit_code = _pclose(pipe);
+    return result;
+}
+
+#else
+
+namespace detail {
+
+inline int decodeWaitStatus(int status) {
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return -1;
+}
+
+inline void recordUsage(ProcessResult& result, const rusage& usage) {
+    result.user_seconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+    result.system_seconds = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+#ifdef __APPLE__
+    result.max_rss_kb = static_cast<long>(usage.ru_maxrss / 1024); // bytes there
+#else
+    result.max_rss_kb = static_cast<long>(usage.ru_maxrss);
+#endif
+}
+
+inline bool makePipe(int fds[2]) {
+#ifdef __linux__
+    return pipe2(fds, O_CLOEXEC) == 0;
+#else
+    if (pipe(fds) != 0) return false;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return true;
+#endif
+}
+
+} // namespace detail
+
+// Spawns argv[0] (looked up in PATH) without going through /bin/sh and
+// waits for it to finish.
+inline ProcessResult runProcess(const std::vector<std::string>& argv, const ProcessOptions& options = {}) {
+    ProcessResult result;
+    if (argv.empty()) return result;
+
+    std::vector<char*> args;
+    args.reserve(argv.size() + 1);
+    for (const auto& arg : argv) {
+        args.push_back(const_cast<char*>(arg.c_str()));
+    }
+    args.push_back(nullptr);
+
+    // Pipe ends are close-on-exec so that children spawned concurrently by
+    // other threads do not hold our write end open and delay EOF.
+    int fds[2] = {-1, -1};
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+
+    if (options.capture) {
+        if (!detail::makePipe(fds)) {
+            posix_spawn_file_actions_destroy(&actions);
+            result.output = std::string("pipe: ") + std::strerror(errno) + "\n";
+            return result;
+        }
+        posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, fds[1], STDERR_FILENO);
+    }
+
+    pid_t pid;
+    int err = posix_spawnp(&pid, args[0], &actions, nullptr, args.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+
+    if (options.capture) close(fds[1]);
+
+    if (err != 0) {
+        if (options.capture) close(fds[0]);
+        result.exit_code = 127;
+        result.output = argv[0] + ": " + std::strerror(err) + "\n";
+        return result;
+    }
+
+    using clock = std::chrono::steady_clock;
+    const bool has_deadline = options.timeout.count() > 0;
+    const auto deadline = clock::now() + options.timeout;
+
+    auto remainingMs = [&]() -> int {
+        if (!has_deadline) return -1;
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock::now());
+        return left.count() > 0 ? static_cast<int>(left.count()) : 0;
+    };
+
+    if (options.capture) {
+        pollfd pfd{fds[0], POLLIN, 0};
+        char buffer[4096];
+
+        while (true) {
+            int ready = poll(&pfd, 1, remainingMs());
+            if (ready < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            if (ready == 0) {
+                kill(pid, SIGKILL);
+                result.timed_out = true;
+                break;
+            }
+
+            ssize_t n = read(fds[0], buffer, sizeof(buffer));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            result.output.append(buffer, static_cast<size_t>(n));
+        }
+        close(fds[0]);
+    }
+
+    int status = 0;
+    rusage usage{};
+    if (has_deadline && !result.timed_out) {
+        while (wait4(pid, &status, WNOHANG, &usage) == 0) {
+            if (remainingMs() == 0) {
+                kill(pid, SIGKILL);
+                result.timed_out = true;
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        if (!result.timed_out) {
+            result.exit_code = detail::decodeWaitStatus(status);
+            detail::recordUsage(result, usage);
+            return result;
+        }
+    }
+
+    while (wait4(pid, &status, 0, &usage) < 0 && errno == EINTR) {}
+    result.exit_code = detail::decodeWaitStatus(status);
+    detail::recordUsage(result, usage);
+    return result;
+}
+
+// A child that runs alongside us on our stdout/stderr, such as the program
+// `cppkg run --watch` restarts after every rebuild.
+class BackgroundProcess {
+public:
+    BackgroundProcess() = default;
+    BackgroundProcess(const BackgroundProcess&) = delete;
+    BackgroundProcess& operator=(const BackgroundProcess&) = delete;
+    ~BackgroundProcess() { stop(); }
+
+    bool start(const std::vector<std::string>& argv) {
+        stop();
+        if (argv.empty()) return false;
+
+        std::vector<char*> args;
+        for (const auto& arg : argv) {
+            args.push_back(const_cast<char*>(arg.c_str()));
+        }
+        args.push_back(nullptr);
+
+        pid_t pid;
+        if (posix_spawnp(&pid, args[0], nullptr, nullptr, args.data(), environ) != 0) return false;
+        pid_ = pid;
+        return true;
+    }
+
+    bool running() {
+        if (pid_ < 0) return false;
+        int status = 0;
+        if (waitpid(pid_, &status, WNOHANG) == 0) return true;
+        exit_code_ = detail::decodeWaitStatus(status);
+        pid_ = -1;
+        return false;
+    }
+
+    // Exit code of the last child once it has finished, -1 before that.
+    int exitCode() const { return exit_code_; }
+
+    // SIGTERM first; SIGKILL if the child is still there after `grace`.
+    void stop(std::chrono::milliseconds grace = std::chrono::milliseconds(2000)) {
+        if (!running()) return;
+
+        kill(pid_, SIGTERM);
+        auto deadline = std::chrono::steady_clock::now() + grace;
+        while (running()) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                kill(pid_, SIGKILL);
+                int status = 0;
+                while (waitpid(pid_, &status, 0) < 0 && errno == EINTR) {}
+                exit_code_ = detail::decodeWaitStatus(status);
+                pid_ = -1;
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+
+private:
+    pid_t pid_ = -1;
+    int exit_code_ = -1;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef QUICK_CPPKG_PROFILE_HPP
+#define QUICK_CPPKG_PROFILE_HPP
+
+#include "nlohmann/json.hpp"
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+// A named set of code generation settings. Each profile builds into its
+// own build/<name>/ tree, so switching profiles never discards the objects
+// of another one.
+struct BuildProfile {
+    std::string name;
+    std::vector<std::string> flags;      // passed to every compile and to the link
+    std::vector<std::string> link_flags; // passed to the link only
+    std::string lto;                     // "", "full" or "thin"
+    bool split_dwarf = false;            // debug info in .dwo files, indexed at link time
+};
+
+// Sanitizers and coverage instrumentation are layered on top of any
+// profile and get their own tree next to it, e.g. build/debug-address-undefined/
+// or build/release-coverage/, so switching to an instrumented build and back
+// recompiles nothing.
+inline std::string variantDirectory(const std::string& profile, std::vector<std::string> sanitizers, bool coverage) {
+    std::sort(sanitizers.begin(), sanitizers.end());
+    sanitizers.erase(std::unique(sanitizers.begin(), sanitizers.end()), sanitizers.end());
+
+    std::string directory = profile;
+    for (const auto& sanitizer : sanitizers) {
+        directory += "-" + sanitizer;
+    }
+    if (coverage) directory += "-coverage";
+    return directory;
+}
+
+// debug, release and relwithdebinfo are built in. cppkg.json may override
+// them or add custom profiles under "profiles":
+//
+//   "profiles": {
+//     "production": {"inherits": "release", "lto": "thin", "flags": ["-march=x86-64-v3"]}
+//   }
+//
+// "flags" and "link_flags" are appended to those of the inherited profile,
+// "lto" replaces its setting (false turns LTO off). "split_dwarf": true
+// keeps debug info out of the objects so the linker does not copy it.
+class ProfileResolver {
+public:
+    ProfileResolver(const json& config, bool msvc) : msvc_(msvc) {
+        if (config.contains("profiles") && config["profiles"].is_object()) {
+            profiles_ = config["profiles"];
+        }
+    }
+
+    BuildProfile resolve(const std::string& name) {
+        std::set<std::string> seen;
+        return resolve(name, seen);
+    }
+
+private:
+    json profiles_ = json::object();
+    bool msvc_;
+
+    BuildProfile builtin(const std::string& name) const {
+        BuildProfile profile;
+        profile.name = name;
+        if (name == "debug") {
+            profile.flags = msvc_ ? std::vector<std::string>{"/Od", "/Zi"} : std::vector<std::string>{"-O0", "-g"};
+        } else if (name == "release") {
+            profile.flags = msvc_ ? std::vector<std::string>{"/O2", "/DNDEBUG"} : std::vector<std::string>{"-O2", "-DNDEBUG"};
+        } else if (name == "relwithdebinfo") {
+            profile.flags = msvc_ ? std::vector<std::string>{"/O2", "/Zi", "/DNDEBUG"}
+                                  : std::vector<std::string>{"-O2", "-g", "-DNDEBUG"};
+        } else {
+            throw std::runtime_error("Unknown build profile '" + name + "'");
+        }
+        return profile;
+    }
+
+    static bool isBuiltin(const std::string& name) {
+        return name == "debug" || name == "release" || name == "relwithdebinfo";
+    }
+
+    BuildProfile resolve(const std::string& name, std::set<std::string>& seen) {
+        if (!seen.insert(name).second) {
+            throw std::runtime_error("Build profile '" + name + "' inherits from itself");
+        }
+
+        if (!profiles_.contains(name)) return builtin(name);
+
+        const json& entry = profiles_[name];
+        if (!entry.is_object()) {
+            throw std::runtime_error("Build profile '" + name + "' must be an object");
+        }
+
+        // An entry named after a built-in profile extends it by default.
+        std::string base = entry.value("inherits", isBuiltin(name) ? name : "debug");
+        BuildProfile profile = base == name ? builtin(name) : resolve(base, seen);
+        profile.name = name;
+
+        for (const auto& flag : entry.value("flags", std::vector<std::string>{})) {
+            profile.flags.push_back(flag);
+        }
+        for (const auto& flag : entry.value("link_flags", std::vector<std::string>{})) {
+            profile.link_flags.push_back(flag);
+        }
+
+        if (entry.contains("lto")) {
+            const json& lto = entry["lto"];
+            if (lto.is_boolean()) {
+                profile.lto = lto.get<bool>() ? "full" : "";
+            } else if (lto.is_string() && (lto == "full" || lto == "thin")) {
+                profile.lto = lto.get<std::string>();
+            } else {
+                throw std::runtime_error("Build profile '" + name + "': \"lto\" must be true, false, \"full\" or \"thin\"");
+            }
+        }
+
+        if (entry.contains("split_dwarf")) {
+            if (!entry["split_dwarf"].is_boolean()) {
+                throw std::runtime_error("Build profile '" + name + "': \"split_dwarf\" must be true or false");
+            }
+            profile.split_dwarf = !msvc_ && entry["split_dwarf"].get<bool>();
+        }
+        return profile;
+    }
+};
+
+#endif
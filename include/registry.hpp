@@ -0,0 +1,136 @@
+#ifndef QUICK_CPPKG_REGISTRY_HPP
+#define QUICK_CPPKG_REGISTRY_HPP
+
+#include "nlohmann/json.hpp"
+#include "semver.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+// One published version of a package, as described by the registry index.
+struct PackageRelease {
+    std::string name;
+    Version version;
+    std::string url;          // archive location; relative paths are resolved against the registry
+    std::string sha256;       // hash of the archive
+    std::string type;         // header-only / static / shared
+    std::string include_dir;  // relative to the unpacked package root
+    std::string library;      // relative to the unpacked package root, empty for header-only
+    std::map<std::string, std::string> dependencies; // name -> constraint
+    std::string build_system;                        // "" (prebuilt), "cmake" or "cppkg"
+    std::vector<std::string> build_options;          // extra arguments for the build system
+};
+
+// Reads the optional "build" entry of a release: {"system": ..., "options": [...]}.
+template <typename Json>
+void readBuildRecipe(const Json& entry, PackageRelease& release) {
+    if (!entry.contains("build") || !entry["build"].is_object()) return;
+    release.build_system = entry["build"].value("system", "");
+    release.build_options = entry["build"].value("options", std::vector<std::string>{});
+}
+
+// A registry is a directory holding one <name>.json index per package:
+//
+//   { "versions": { "9.1.0": { "url": "fmt-9.1.0.tar.gz", "sha256": "...",
+//                              "type": "static", "include": "include",
+//                              "library": "lib/libfmt.a",
+//                              "dependencies": { "other": "^1.0" },
+//                              "build": { "system": "cmake", "options": [] } } } }
+//
+// Releases with a "build" entry ship sources; "library" and "include" are
+// then relative to the prefix the package is installed into.
+//
+// Each index is read at most once per Registry instance.
+class Registry {
+public:
+    explicit Registry(fs::path root) : root_(std::move(root)) {}
+
+    // `configured` is the "registry" entry of cppkg.json, if any; otherwise
+    // $CPPKG_REGISTRY, then ~/.cppkg/registry.
+    static fs::path locate(const std::string& configured) {
+        if (!configured.empty()) return configured;
+        if (const char* dir = std::getenv("CPPKG_REGISTRY")) return dir;
+        #ifdef _WIN32
+            const char* home = std::getenv("USERPROFILE");
+        #else
+            const char* home = std::getenv("HOME");
+        #endif
+        return fs::path(home ? home : ".") / ".cppkg" / "registry";
+    }
+
+    const fs::path& root() const { return root_; }
+
+    bool contains(const std::string& name) {
+        return !releases(name).empty();
+    }
+
+    // All releases of `name`, newest first.
+    const std::vector<PackageRelease>& releases(const std::string& name) {
+        auto cached = index_.find(name);
+        if (cached != index_.end()) return cached->second;
+
+        std::vector<PackageRelease>& releases = index_[name];
+
+        std::ifstream file(root_ / (name + ".json"));
+        if (!file) return releases;
+
+        json index;
+        try {
+            index = json::parse(file);
+        } catch (const json::parse_error& e) {
+            throw std::runtime_error("Malformed registry index for '" + name + "': " + e.what());
+        }
+
+        const json versions = index.value("versions", json::object());
+        for (const auto& [text, entry] : versions.items()) {
+            auto version = Version::parse(text);
+            if (!version) continue;
+
+            PackageRelease release;
+            release.name = name;
+            release.version = *version;
+            release.url = entry.value("url", "");
+            release.sha256 = entry.value("sha256", "");
+            release.type = entry.value("type", "header-only");
+            release.include_dir = entry.value("include", "include");
+            release.library = entry.value("library", "");
+            release.dependencies = entry.value("dependencies", std::map<std::string, std::string>{});
+            readBuildRecipe(entry, release);
+            releases.push_back(std::move(release));
+        }
+
+        std::sort(releases.begin(), releases.end(), [](const PackageRelease& a, const PackageRelease& b) {
+            return a.version > b.version;
+        });
+        return releases;
+    }
+
+    const PackageRelease* find(const std::string& name, const Version& version) {
+        for (const auto& release : releases(name)) {
+            if (release.version == version) return &release;
+        }
+        return nullptr;
+    }
+
+    // Turns a release's url into something the fetcher can open.
+    std::string resolveUrl(const std::string& url) const {
+        if (url.find("://") != std::string::npos || fs::path(url).is_absolute()) return url;
+        return (root_ / url).string();
+    }
+
+private:
+    fs::path root_;
+    std::unordered_map<std::string, std::vector<PackageRelease>> index_;
+};
+
+#endif
@@ -0,0 +1,654 @@
+#ifndef QUICK_CPPKG_REMOTE_HPP
+#define QUICK_CPPKG_REMOTE_HPP
+
+#include "command.hpp"
+#include "nlohmann/json.hpp"
+#include "process.hpp"
+#include "toolchain.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+    #include <cerrno>
+    #include <csignal>
+    #include <cstring>
+    #include <fcntl.h>
+    #include <netdb.h>
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+// Remote compilation: `cppkg build` preprocesses a source locally and sends
+// the result with its flags to a `cppkg worker`, which compiles it with the
+// same compiler and sends the object back. Every exchange is one request
+// and one reply on a fresh connection; a message is a line of JSON followed
+// by the `size` bytes of payload it announces.
+//
+// Workers run whatever flags they are sent, within remoteArgumentAllowed,
+// so they belong on trusted networks only.
+
+constexpr int kRemoteProtocol = 1;
+constexpr const char* kDefaultWorkerAddress = "127.0.0.1:7878";
+
+// "unix:/path" (or anything with a '/') is a Unix socket, "host:port" TCP.
+struct WorkerAddress {
+    std::string text;
+    std::string unix_path;
+    std::string host;
+    std::string port;
+
+    static WorkerAddress parse(const std::string& text) {
+        WorkerAddress address;
+        address.text = text;
+        if (text.rfind("unix:", 0) == 0) {
+            address.unix_path = text.substr(5);
+        } else if (text.find('/') != std::string::npos) {
+            address.unix_path = text;
+        } else {
+            auto colon = text.rfind(':');
+            if (colon == std::string::npos || colon + 1 == text.size()) {
+                throw std::runtime_error("Worker address '" + text + "' needs a port, e.g. " + kDefaultWorkerAddress);
+            }
+            address.host = text.substr(0, colon);
+            address.port = text.substr(colon + 1);
+            // [::1]:7878
+            if (address.host.size() > 1 && address.host.front() == '[' && address.host.back() == ']') {
+                address.host = address.host.substr(1, address.host.size() - 2);
+            }
+        }
+        return address;
+    }
+};
+
+// Compiler flags a worker accepts. Preprocessing already happened, so
+// include paths and macros are pointless, and a compile must not read or
+// write any file besides its input and the object. -f options therefore
+// come from a list of code-generation, language and diagnostic switches
+// (plugins, profiles, dumps and remarks such as -fpass-plugin= or
+// -fopt-info-all=file are not on it), and no option may carry a path.
+inline bool remoteArgumentAllowed(const std::string& arg) {
+    static const char* const allowed[] = {"-std=", "-W", "-O", "-g", "-m", "-pedantic", "-pthread"};
+    static const char* const refused[] = {"-Wa,", "-Wl,", "-Wp,", "-mllvm", "-gsplit-dwarf"};
+    // -f switches, also accepted with "no-"; those ending in '=' take a value.
+    static const std::set<std::string> switches = {
+        "PIC", "pic", "PIE", "pie", "plt", "common", "exceptions", "cxx-exceptions", "rtti",
+        "omit-frame-pointer", "strict-aliasing", "strict-overflow", "wrapv", "trapv", "fast-math",
+        "finite-math-only", "math-errno", "unroll-loops", "inline", "inline-functions",
+        "inline-small-functions", "vectorize", "slp-vectorize", "tree-vectorize", "tree-slp-vectorize",
+        "data-sections", "function-sections", "lto", "fat-lto-objects", "split-lto-unit",
+        "whole-program-vtables", "threadsafe-statics", "sized-deallocation", "aligned-new",
+        "strict-enums", "permissive", "builtin", "freestanding", "signed-char", "unsigned-char",
+        "char8_t", "coroutines", "concepts", "elide-constructors", "delete-null-pointer-checks",
+        "semantic-interposition", "asynchronous-unwind-tables", "unwind-tables", "stack-protector",
+        "stack-protector-strong", "stack-protector-all", "stack-clash-protection", "cf-protection",
+        "visibility-inlines-hidden", "debug-types-section", "standalone-debug", "limit-debug-info",
+        "eliminate-unused-debug-types", "var-tracking", "var-tracking-assignments",
+        "color-diagnostics", "diagnostics-color", "diagnostics-show-option", "show-column",
+        "sanitize-recover", "operator-names", "gnu-keywords",
+        "visibility=", "lto=", "sanitize=", "sanitize-recover=", "sanitize-trap=", "cf-protection=",
+        "diagnostics-color=", "message-length=", "max-errors=", "error-limit=", "template-depth=",
+        "constexpr-depth=", "constexpr-steps=", "trivial-auto-var-init=", "abi-version=",
+    };
+
+    size_t equals = arg.find('=');
+    if (equals != std::string::npos) {
+        std::string value = arg.substr(equals + 1);
+        if (value.find_first_of("/\\") != std::string::npos ||
+            (!value.empty() && (value[0] == '.' || value[0] == '~' || value[0] == '@'))) {
+            return false;
+        }
+    }
+    if (arg.rfind("-f", 0) == 0) {
+        std::string name = arg.substr(2);
+        if (name.rfind("no-", 0) == 0) name = name.substr(3);
+        if (equals != std::string::npos) name = name.substr(0, name.find('=') + 1);
+        return switches.count(name) > 0;
+    }
+    for (const char* prefix : refused) {
+        if (arg.rfind(prefix, 0) == 0) return false;
+    }
+    for (const char* prefix : allowed) {
+        if (arg.rfind(prefix, 0) == 0) return true;
+    }
+    return false;
+}
+
+#ifndef _WIN32
+
+inline void closeSocket(int fd) {
+    if (fd >= 0) ::close(fd);
+}
+
+// Waits at most `timeout` for `fd` to become ready for `events`.
+inline bool waitSocket(int fd, short events, std::chrono::milliseconds timeout) {
+    pollfd pfd{fd, events, 0};
+    while (true) {
+        int ready = ::poll(&pfd, 1, static_cast<int>(timeout.count()));
+        if (ready < 0 && errno == EINTR) continue;
+        return ready > 0;
+    }
+}
+
+// Returns a connected socket, or -1 if the worker cannot be reached within
+// `timeout`.
+inline int connectTo(const WorkerAddress& address, std::chrono::milliseconds timeout) {
+    auto attempt = [&](int fd, const sockaddr* addr, socklen_t length) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+        int rc = ::connect(fd, addr, length);
+        if (rc != 0 && errno == EINPROGRESS && waitSocket(fd, POLLOUT, timeout)) {
+            int error = 0;
+            socklen_t size = sizeof(error);
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &size);
+            rc = error == 0 ? 0 : -1;
+        }
+        fcntl(fd, F_SETFL, flags);
+        return rc == 0;
+    };
+
+    if (!address.unix_path.empty()) {
+        sockaddr_un addr{};
+        if (address.unix_path.size() >= sizeof(addr.sun_path)) return -1;
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, address.unix_path.c_str(), sizeof(addr.sun_path) - 1);
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && attempt(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr))) return fd;
+        closeSocket(fd);
+        return -1;
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* results = nullptr;
+    if (getaddrinfo(address.host.c_str(), address.port.c_str(), &hints, &results) != 0) return -1;
+
+    int connected = -1;
+    for (addrinfo* info = results; info && connected < 0; info = info->ai_next) {
+        int fd = ::socket(info->ai_family, info->ai_socktype | SOCK_CLOEXEC, info->ai_protocol);
+        if (fd >= 0 && attempt(fd, info->ai_addr, info->ai_addrlen)) {
+            connected = fd;
+        } else {
+            closeSocket(fd);
+        }
+    }
+    freeaddrinfo(results);
+    return connected;
+}
+
+inline int listenOn(const WorkerAddress& address) {
+    if (!address.unix_path.empty()) {
+        sockaddr_un addr{};
+        if (address.unix_path.size() >= sizeof(addr.sun_path)) {
+            throw std::runtime_error("Socket path is too long: " + address.unix_path);
+        }
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, address.unix_path.c_str(), sizeof(addr.sun_path) - 1);
+
+        // A socket left behind by a previous worker.
+        std::error_code ec;
+        if (fs::is_socket(address.unix_path, ec)) fs::remove(address.unix_path, ec);
+
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd, 128) != 0) {
+            std::string error = std::strerror(errno);
+            closeSocket(fd);
+            throw std::runtime_error("Cannot listen on " + address.text + ": " + error);
+        }
+        return fd;
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* results = nullptr;
+    if (int rc = getaddrinfo(address.host.c_str(), address.port.c_str(), &hints, &results); rc != 0) {
+        throw std::runtime_error("Cannot resolve " + address.text + ": " + gai_strerror(rc));
+    }
+
+    int fd = -1;
+    std::string error = "no usable address";
+    for (addrinfo* info = results; info && fd < 0; info = info->ai_next) {
+        fd = ::socket(info->ai_family, info->ai_socktype | SOCK_CLOEXEC, info->ai_protocol);
+        if (fd < 0) continue;
+        int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (::bind(fd, info->ai_addr, info->ai_addrlen) != 0 || ::listen(fd, 128) != 0) {
+            error = std::strerror(errno);
+            closeSocket(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(results);
+    if (fd < 0) throw std::runtime_error("Cannot listen on " + address.text + ": " + error);
+    return fd;
+}
+
+inline bool sendAll(int fd, const char* data, size_t size) {
+    #ifdef MSG_NOSIGNAL
+        const int flags = MSG_NOSIGNAL;
+    #else
+        const int flags = 0;
+    #endif
+    while (size > 0) {
+        ssize_t n = ::send(fd, data, size, flags);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+inline bool sendMessage(int fd, json header, const std::string& payload = "") {
+    header["size"] = payload.size();
+    std::string line = header.dump() + "\n";
+    return sendAll(fd, line.data(), line.size()) && sendAll(fd, payload.data(), payload.size());
+}
+
+// Reads one message, giving up when the peer stays silent for `timeout`.
+inline bool receiveMessage(int fd, json& header, std::string& payload, std::chrono::milliseconds timeout) {
+    constexpr size_t kMaxHeader = 1 << 20;
+    constexpr size_t kMaxPayload = size_t{1} << 30;
+
+    std::string buffer;
+    char chunk[65536];
+    size_t newline = std::string::npos;
+    while (newline == std::string::npos) {
+        if (buffer.size() > kMaxHeader || !waitSocket(fd, POLLIN, timeout)) return false;
+        ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buffer.append(chunk, static_cast<size_t>(n));
+        newline = buffer.find('\n');
+    }
+
+    try {
+        header = json::parse(buffer.substr(0, newline));
+    } catch (const json::parse_error&) {
+        return false;
+    }
+    size_t size = header.value("size", size_t{0});
+    if (size > kMaxPayload) return false;
+
+    payload = buffer.substr(newline + 1);
+    payload.reserve(size);
+    while (payload.size() < size) {
+        if (!waitSocket(fd, POLLIN, timeout)) return false;
+        ssize_t n = ::recv(fd, chunk, std::min(sizeof(chunk), size - payload.size()), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        payload.append(chunk, static_cast<size_t>(n));
+    }
+    return payload.size() == size;
+}
+
+#endif
+
+// `cppkg worker`: compiles preprocessed sources for builds on other
+// machines (or in other checkouts). At most `jobs` compiles run at once;
+// requests beyond that are answered "busy" right away so the client
+// compiles them itself instead of queueing here. Connections are served
+// by at most `jobs` + kSpareConnections threads; further clients wait in
+// the listen backlog. SIGINT and SIGTERM stop it once the open
+// connections are answered, and its scratch directory goes with it.
+class WorkerHandler : public CommandHandler {
+public:
+    WorkerHandler(std::string listen, size_t jobs)
+        : address_(WorkerAddress::parse(listen.empty() ? kDefaultWorkerAddress : listen)),
+          slots_(jobs ? jobs : std::max(1u, std::thread::hardware_concurrency())) {}
+
+    void execute() override {
+#ifdef _WIN32
+        throw std::runtime_error("cppkg worker needs a POSIX system");
+#else
+        auto toolchain = ToolchainProbe().detect();
+        if (!toolchain || toolchain->isMsvc()) {
+            throw std::runtime_error("No g++ or clang++ found for the worker; install one or point CXX at it");
+        }
+        toolchain_ = *toolchain;
+        work_dir_ = fs::temp_directory_path() / ("cppkg-worker-" + std::to_string(getpid()));
+        fs::create_directories(work_dir_);
+        std::signal(SIGPIPE, SIG_IGN);
+        std::signal(SIGINT, requestStop);
+        std::signal(SIGTERM, requestStop);
+
+        int listener = listenOn(address_);
+        std::string version = toolchain_.version.substr(0, toolchain_.version.find('\n'));
+        std::cout << "🛠️  cppkg worker listening on " << address_.text << " with " << slots_ << " slot(s), "
+                  << version << std::endl;
+
+        std::string error;
+        while (!stop_ && error.empty()) {
+            if (!waitSocket(listener, POLLIN, kStopPoll)) continue;
+            {
+                std::unique_lock<std::mutex> lock(connections_mutex_);
+                if (connections_ >= slots_ + kSpareConnections) {
+                    connection_closed_.wait_for(lock, kStopPoll);
+                    continue;
+                }
+                ++connections_;
+            }
+            int client = ::accept(listener, nullptr, nullptr);
+            if (client < 0) {
+                if (errno != EINTR && errno != ECONNABORTED && errno != EAGAIN) {
+                    error = std::string("accept: ") + std::strerror(errno);
+                }
+                closeConnection();
+                continue;
+            }
+            std::thread([this, client]() {
+                serve(client);
+                closeSocket(client);
+                closeConnection();
+            }).detach();
+        }
+
+        // A second Ctrl+C stops without waiting.
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+        closeSocket(listener);
+        {
+            std::unique_lock<std::mutex> lock(connections_mutex_);
+            if (connections_ > 0) {
+                std::cout << "\033[90m" << "⏳ Answering " << connections_ << " open connection(s)" << "\033[0m" << std::endl;
+            }
+            connection_closed_.wait(lock, [this]() { return connections_ == 0; });
+        }
+        std::error_code ec;
+        fs::remove_all(work_dir_, ec);
+        if (!address_.unix_path.empty()) fs::remove(address_.unix_path, ec);
+
+        if (!error.empty()) throw std::runtime_error(error);
+        std::cout << "👋 cppkg worker stopped" << std::endl;
+#endif
+    }
+
+private:
+    WorkerAddress address_;
+    size_t slots_;
+    Toolchain toolchain_;
+    fs::path work_dir_;
+    std::atomic<size_t> active_{0};
+    std::atomic<uint64_t> requests_{0};
+    std::mutex log_mutex_;
+    size_t connections_ = 0;
+    std::mutex connections_mutex_;
+    std::condition_variable connection_closed_;
+
+#ifndef _WIN32
+    static inline volatile std::sig_atomic_t stop_ = 0;
+
+    static void requestStop(int) { stop_ = 1; }
+
+    static constexpr std::chrono::milliseconds kReadTimeout{30000};
+    static constexpr std::chrono::milliseconds kStopPoll{250};
+    // Connections past the compile slots only read a request and answer
+    // it (hello, errors, busy), so a few of them are enough.
+    static constexpr size_t kSpareConnections = 16;
+
+    void closeConnection() {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        --connections_;
+        connection_closed_.notify_all();
+    }
+
+    void serve(int client) {
+        json request;
+        std::string payload;
+        if (!receiveMessage(client, request, payload, kReadTimeout)) return;
+
+        if (request.value("protocol", 0) != kRemoteProtocol) {
+            sendMessage(client, {{"status", "error"}, {"message", "unsupported protocol version"}});
+            return;
+        }
+
+        std::string type = request.value("type", "");
+        if (type == "hello") {
+            sendMessage(client, {{"status", "ok"}, {"slots", slots_}, {"identity", toolchain_.identity()}});
+            return;
+        }
+        if (type != "compile") {
+            sendMessage(client, {{"status", "error"}, {"message", "unknown request '" + type + "'"}});
+            return;
+        }
+
+        if (request.value("identity", "") != toolchain_.identity()) {
+            sendMessage(client, {{"status", "error"}, {"message", "the worker runs a different compiler"}});
+            return;
+        }
+        std::vector<std::string> args = request.value("args", std::vector<std::string>{});
+        for (const auto& arg : args) {
+            if (!remoteArgumentAllowed(arg)) {
+                sendMessage(client, {{"status", "error"}, {"message", "flag not accepted: " + arg}});
+                return;
+            }
+        }
+
+        if (active_.fetch_add(1) >= slots_) {
+            --active_;
+            sendMessage(client, {{"status", "busy"}});
+            return;
+        }
+        json reply;
+        std::string object;
+        compile(request, args, payload, reply, object);
+        --active_;
+        sendMessage(client, reply, object);
+    }
+
+    void compile(const json& request, std::vector<std::string> args, const std::string& source,
+                 json& reply, std::string& object) {
+        auto begin = std::chrono::steady_clock::now();
+        fs::path dir = work_dir_ / std::to_string(++requests_);
+        fs::create_directories(dir);
+        std::string input = (dir / "tu.ii").string();
+        std::string output = (dir / "tu.o").string();
+        std::ofstream(input, std::ios::binary) << source;
+
+        // Debug info should name the client's checkout rather than this
+        // process's working directory. g++ -E already recorded it in the
+        // source; clang++ has to be told.
+        std::string cwd = request.value("cwd", "");
+        if (!cwd.empty() && toolchain_.isClang()) args.push_back("-fdebug-compilation-dir=" + cwd);
+
+        std::vector<std::string> cmd = {toolchain_.compiler};
+        cmd.insert(cmd.end(), args.begin(), args.end());
+        cmd.insert(cmd.end(), {"-x", "c++-cpp-output", "-c", input, "-o", output});
+        ProcessResult result = runProcess(cmd);
+
+        reply = {{"status", "done"}, {"exit_code", result.exit_code}, {"output", result.output}};
+        if (result.exit_code == 0) {
+            std::ifstream file(output, std::ios::binary);
+            std::stringstream buffer;
+            buffer << file.rdbuf();
+            object = buffer.str();
+        }
+        std::error_code ec;
+        fs::remove_all(dir, ec);
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::lock_guard<std::mutex> lock(log_mutex_);
+        std::cout << (result.exit_code == 0 ? "🔧 " : "❌ ") << request.value("name", "?") << " ("
+                  << std::fixed << std::setprecision(2) << seconds << " s)" << std::endl;
+    }
+#endif
+};
+
+struct RemoteCompile {
+    int exit_code = -1;
+    std::string output;
+    std::string object;
+};
+
+// The workers a build sends compiles to. Compiles take a slot first:
+// a free one on a worker if there is any, else one of `local_slots` on
+// this machine, so remote workers add to local parallelism without the
+// local compiles a build still does (modules, refused flags, fallbacks)
+// overloading this machine.
+class RemoteWorkers {
+public:
+    RemoteWorkers(const std::vector<std::string>& addresses, std::string identity, size_t local_slots)
+        : identity_(std::move(identity)), local_free_(std::max<size_t>(1, local_slots)) {
+        for (const auto& address : addresses) {
+            workers_.push_back({WorkerAddress::parse(address)});
+        }
+    }
+
+    // Asks each worker for its slot count. Workers that cannot be reached
+    // or run a different compiler are left out of this build.
+    void connect() {
+#ifndef _WIN32
+        for (auto& worker : workers_) {
+            json reply;
+            std::string payload;
+            std::string problem = "unreachable";
+            int fd = connectTo(worker.address, kConnectTimeout);
+            if (fd >= 0 && sendMessage(fd, {{"protocol", kRemoteProtocol}, {"type", "hello"}}) &&
+                receiveMessage(fd, reply, payload, kConnectTimeout)) {
+                if (reply.value("identity", "") != identity_) {
+                    problem = "runs a different compiler";
+                } else {
+                    worker.slots = worker.free = reply.value("slots", size_t{0});
+                    problem.clear();
+                }
+            }
+            closeSocket(fd);
+            if (!problem.empty()) {
+                std::cerr << "\033[33m" << "⚠️  Worker " << worker.address.text << " " << problem << ", compiling without it"
+                          << "\033[0m" << std::endl;
+            }
+        }
+#endif
+    }
+
+    size_t slots() const {
+        size_t total = 0;
+        for (const auto& worker : workers_) total += worker.slots;
+        return total;
+    }
+
+    size_t reachable() const {
+        return std::count_if(workers_.begin(), workers_.end(), [](const Worker& worker) { return worker.slots > 0; });
+    }
+
+    // Blocks for a slot. Returns a worker index, or -1 for a local slot.
+    // `remote` false asks for a local slot only.
+    int acquire(bool remote) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            if (remote) {
+                int best = -1;
+                for (size_t i = 0; i < workers_.size(); ++i) {
+                    const Worker& worker = workers_[i];
+                    if (!worker.down && worker.free > 0 && (best < 0 || worker.free > workers_[best].free)) {
+                        best = static_cast<int>(i);
+                    }
+                }
+                if (best >= 0) {
+                    --workers_[best].free;
+                    return best;
+                }
+            }
+            if (local_free_ > 0) {
+                --local_free_;
+                return -1;
+            }
+            released_.wait(lock);
+        }
+    }
+
+    void release(int slot) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (slot < 0) {
+                ++local_free_;
+            } else {
+                ++workers_[slot].free;
+            }
+        }
+        released_.notify_all();
+    }
+
+    const std::string& name(int slot) const { return workers_[slot].address.text; }
+
+    // Compiles preprocessed `source` on worker `slot`. Returns nothing if
+    // the worker is busy or failed, as opposed to the compile failing;
+    // a worker that failed gets no more work in this build.
+    std::optional<RemoteCompile> compile(int slot, const std::vector<std::string>& args, const std::string& name,
+                                         const std::string& source) {
+#ifdef _WIN32
+        return std::nullopt;
+#else
+        Worker& worker = workers_[slot];
+        json request = {
+            {"protocol", kRemoteProtocol}, {"type", "compile"}, {"identity", identity_},
+            {"args", args}, {"name", name}, {"cwd", fs::current_path().string()}
+        };
+
+        json reply;
+        std::string object;
+        int fd = connectTo(worker.address, kConnectTimeout);
+        bool ok = fd >= 0 && sendMessage(fd, request, source) && receiveMessage(fd, reply, object, kCompileTimeout);
+        closeSocket(fd);
+
+        std::string status = ok ? reply.value("status", "") : "";
+        if (status == "busy") return std::nullopt;
+        if (status != "done") {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!worker.down) {
+                worker.down = true;
+                std::cerr << "\033[33m" << "⚠️  Worker " << worker.address.text << " failed ("
+                          << (ok ? reply.value("message", status) : "connection lost")
+                          << "), compiling without it" << "\033[0m" << std::endl;
+            }
+            return std::nullopt;
+        }
+
+        RemoteCompile result;
+        result.exit_code = reply.value("exit_code", -1);
+        result.output = reply.value("output", "");
+        result.object = std::move(object);
+        return result;
+#endif
+    }
+
+private:
+    static constexpr std::chrono::milliseconds kConnectTimeout{2000};
+    static constexpr std::chrono::milliseconds kCompileTimeout{600000};
+
+    struct Worker {
+        WorkerAddress address;
+        size_t slots = 0;
+        size_t free = 0;
+        bool down = false;
+    };
+
+    std::string identity_;
+    std::vector<Worker> workers_;
+    size_t local_free_;
+    std::mutex mutex_;
+    std::condition_variable released_;
+};
+
+#endif
@@ -0,0 +1,237 @@
+#ifndef QUICK_CPPKG_RESOLVER_HPP
+#define QUICK_CPPKG_RESOLVER_HPP
+
+#include "registry.hpp"
+#include "semver.hpp"
+#include <algorithm>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Picks one release per package so that every constraint in the graph holds,
+// preferring the newest versions. This is a backtracking search. It always
+// branches on the package with the fewest remaining candidates and jumps
+// straight back to the most recent package involved in a conflict
+// (conflict-directed backjumping). Every conflict is also remembered as a
+// nogood: a set of package@version choices that cannot all be selected
+// together, so the same dead end is never explored twice. Registry indexes
+// and parsed constraints are memoized.
+class Resolver {
+public:
+    explicit Resolver(Registry& registry) : registry_(registry) {}
+
+    // `roots` maps package names to constraints, as in cppkg.json.
+    // Throws std::runtime_error describing the conflict if no solution exists.
+    std::map<std::string, const PackageRelease*> resolve(const std::map<std::string, std::string>& roots) {
+        std::map<std::string, const PackageRelease*> selected;
+        std::map<std::string, std::vector<Requirement>> requirements;
+
+        for (const auto& [name, constraint] : roots) {
+            if (!registry_.contains(name)) {
+                throw std::runtime_error("Package '" + name + "' not found in registry " + registry_.root().string());
+            }
+            requirements[name].push_back({constraint, ""});
+        }
+
+        nogoods_.clear();
+        nogood_index_.clear();
+        conflict_.clear();
+        Conflict conflict;
+        if (!solve(selected, requirements, conflict)) {
+            throw std::runtime_error(conflict_.empty() ? "Dependency resolution failed" : conflict_);
+        }
+        return selected;
+    }
+
+private:
+    struct Requirement {
+        std::string constraint;
+        std::string from; // package that imposed it, empty for cppkg.json
+    };
+
+    // Names of the packages whose selection caused a failure.
+    using Conflict = std::set<std::string>;
+
+    Registry& registry_;
+    std::unordered_map<std::string, VersionConstraint> constraints_;
+    std::vector<std::vector<std::pair<std::string, const PackageRelease*>>> nogoods_;
+    std::unordered_map<const PackageRelease*, std::vector<size_t>> nogood_index_;
+    std::string conflict_;
+
+    const VersionConstraint& constraint(const std::string& text) {
+        auto it = constraints_.find(text);
+        if (it == constraints_.end()) {
+            it = constraints_.emplace(text, VersionConstraint::parse(text)).first;
+        }
+        return it->second;
+    }
+
+    std::vector<const PackageRelease*> candidates(const std::string& name, const std::vector<Requirement>& requirements) {
+        std::vector<const PackageRelease*> result;
+        for (const auto& release : registry_.releases(name)) {
+            bool ok = true;
+            for (const auto& requirement : requirements) {
+                if (!constraint(requirement.constraint).matches(release.version)) {
+                    ok = false;
+                    break;
+                }
+            }
+            if (ok) result.push_back(&release);
+        }
+        return result;
+    }
+
+    void learn(const Conflict& conflict, const std::map<std::string, const PackageRelease*>& selected) {
+        std::vector<std::pair<std::string, const PackageRelease*>> nogood;
+        for (const auto& name : conflict) {
+            nogood.emplace_back(name, selected.at(name));
+        }
+
+        size_t id = nogoods_.size();
+        for (const auto& entry : nogood) {
+            nogood_index_[entry.second].push_back(id);
+        }
+        nogoods_.push_back(std::move(nogood));
+    }
+
+    // Returns a learned nogood made true by selecting `release`, if any.
+    const std::vector<std::pair<std::string, const PackageRelease*>>* violatedNogood(
+            const PackageRelease* release, const std::map<std::string, const PackageRelease*>& selected) {
+        auto it = nogood_index_.find(release);
+        if (it == nogood_index_.end()) return nullptr;
+
+        for (size_t id : it->second) {
+            bool violated = true;
+            for (const auto& [name, chosen] : nogoods_[id]) {
+                auto current = selected.find(name);
+                if (current == selected.end() || current->second != chosen) {
+                    violated = false;
+                    break;
+                }
+            }
+            if (violated) return &nogoods_[id];
+        }
+        return nullptr;
+    }
+
+    // The packages whose constraints rule out the releases of `name` that are
+    // not in `allowed`. A release excluded by cppkg.json needs no culprit;
+    // otherwise one requirer is blamed per release, preferring one that is
+    // already blamed, so learned conflicts stay small.
+    Conflict explain(const std::string& name, const std::vector<Requirement>& requirements,
+                     const std::vector<const PackageRelease*>& allowed) {
+        Conflict culprits;
+        for (const auto& release : registry_.releases(name)) {
+            if (std::find(allowed.begin(), allowed.end(), &release) != allowed.end()) continue;
+
+            const Requirement* blame = nullptr;
+            for (const auto& requirement : requirements) {
+                if (constraint(requirement.constraint).matches(release.version)) continue;
+                if (requirement.from.empty() || culprits.count(requirement.from)) {
+                    blame = nullptr;
+                    break;
+                }
+                if (!blame) blame = &requirement;
+            }
+            if (blame) culprits.insert(blame->from);
+        }
+        return culprits;
+    }
+
+    void recordConflict(const std::string& name, const std::vector<Requirement>& requirements,
+                        const std::map<std::string, const PackageRelease*>& selected) {
+        conflict_ = registry_.contains(name)
+            ? "No version of '" + name + "' satisfies all requirements:"
+            : "Package '" + name + "' not found in registry " + registry_.root().string() + ", required by:";
+        for (const auto& requirement : requirements) {
+            std::string from = requirement.from.empty()
+                ? "cppkg.json"
+                : requirement.from + "@" + selected.at(requirement.from)->version.toString();
+            conflict_ += "\n  " + requirement.constraint + " (from " + from + ")";
+        }
+    }
+
+    bool solve(std::map<std::string, const PackageRelease*>& selected,
+               std::map<std::string, std::vector<Requirement>>& requirements,
+               Conflict& conflict) {
+        std::string next;
+        std::vector<const PackageRelease*> options;
+        for (const auto& [name, reqs] : requirements) {
+            if (selected.count(name)) continue;
+
+            auto found = candidates(name, reqs);
+            if (found.empty()) {
+                recordConflict(name, reqs, selected);
+                conflict = explain(name, reqs, found);
+                // A package missing from the registry is only a problem
+                // because something required it.
+                if (conflict.empty() && !reqs.front().from.empty()) {
+                    conflict.insert(reqs.front().from);
+                }
+                learn(conflict, selected);
+                return false;
+            }
+            if (next.empty() || found.size() < options.size()) {
+                next = name;
+                options = std::move(found);
+            }
+        }
+
+        if (next.empty()) return true;
+
+        // Whatever narrowed the candidates of `next` is part of any conflict
+        // that exhausts them.
+        Conflict accumulated = explain(next, requirements[next], options);
+
+        for (const PackageRelease* release : options) {
+            selected[next] = release;
+
+            Conflict child;
+            bool consistent = true;
+
+            if (auto nogood = violatedNogood(release, selected)) {
+                for (const auto& entry : *nogood) child.insert(entry.first);
+                consistent = false;
+            }
+
+            for (const auto& [dep, text] : release->dependencies) {
+                requirements[dep].push_back({text, next});
+
+                auto chosen = selected.find(dep);
+                if (consistent && chosen != selected.end() && !constraint(text).matches(chosen->second->version)) {
+                    recordConflict(dep, requirements[dep], selected);
+                    child = {next, dep};
+                    consistent = false;
+                }
+            }
+
+            if (consistent && solve(selected, requirements, child)) return true;
+
+            for (const auto& entry : release->dependencies) {
+                auto& reqs = requirements[entry.first];
+                reqs.pop_back();
+                if (reqs.empty()) requirements.erase(entry.first);
+            }
+            selected.erase(next);
+
+            // The failure did not involve `next`, so no other version of it
+            // can help: skip straight back to a package that was involved.
+            if (!child.count(next)) {
+                conflict = std::move(child);
+                return false;
+            }
+
+            child.erase(next);
+            accumulated.insert(child.begin(), child.end());
+        }
+
+        conflict = std::move(accumulated);
+        learn(conflict, selected);
+        return false;
+    }
+};
+
+#endif
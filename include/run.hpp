@@ -5,7 +5,10 @@
 #define GREEN   "\033[32m"
 #define YELLOW  "\033[33m"
 #define BLUE    "\033[34m"
+#include "bench.hpp"
+#include "build.hpp"
 #include "command.hpp"
+#include "process.hpp"
 #include <filesystem>
 #include "nlohmann/json.hpp"
 #include <iostream>
@@ -14,6 +17,12 @@ using json = nlohmann::json;
 namespace fs = std::filesystem;
 class RunHandler : public CommandHandler{
 public:
+    // `options` picks the build tree (profile, sanitizers, coverage) and
+    // whether to watch; watch mode rebuilds with them too. `bench` with
+    // runs > 0 benchmarks the program instead of running it once.
+    explicit RunHandler(BuildOptions options = {}, std::string target = "", BenchOptions bench = {})
+        : options_(std::move(options)), target_(std::move(target)), bench_(std::move(bench)) {}
+
     void execute() override {
         std::string app_name;
         if (fs::exists("cppkg.json")) {
@@ -26,7 +35,7 @@ public:
             try {
                 json config;
                 file >> config;
-                app_name = config.value("name", "Unnamed Project");
+                app_name = target_.empty() ? defaultTarget(config) : target_;
             } catch (const json::parse_error& e) {
                 std::cerr << RED << "❌ Failed to parse cppkg.json: " << e.what() << RESET << std::endl;
                 return;
@@ -36,9 +45,67 @@ public:
             return;
         }
 
+        if (options_.coverage) {
+            // clang's instrumented binaries honour this; gcc's ignore it.
+            std::string pattern = fs::absolute(buildDirectory() + "/coverage/%p.profraw").string();
+            fs::create_directories(buildDirectory() + "/coverage");
+            #ifdef _WIN32
+                _putenv_s("LLVM_PROFILE_FILE", pattern.c_str());
+            #else
+                setenv("LLVM_PROFILE_FILE", pattern.c_str(), 1);
+            #endif
+        }
+
+        if (options_.watch) {
+            watchExecutable(app_name);
+            return;
+        }
+        if (bench_.runs > 0) {
+            benchmarkExecutable(app_name);
+            return;
+        }
         int exit_code = runExecutable(app_name);
     }
 
+    // Rebuilds on every change and restarts the program whenever it was
+    // relinked.
+    void watchExecutable(const std::string& name) {
+        #ifdef _WIN32
+            throw std::runtime_error("run --watch is not supported on Windows");
+        #else
+            BuildOptions options = options_;
+            options.watch = false;
+            BuildHandler builder(options);
+
+            std::string full_path = buildExecutablePath(name);
+            BackgroundProcess program;
+            bool started = false;
+
+            builder.watch([&](bool relinked) {
+                if (started && !relinked) return;
+                if (program.running()) {
+                    program.stop();
+                    std::cout << YELLOW << "🔁 Restarting " << full_path << RESET << std::endl;
+                } else {
+                    std::cout << BLUE << "▶️ Running: " << full_path << RESET << std::endl;
+                }
+                if (!program.start({full_path})) {
+                    std::cerr << RED << "❌ Failed to start " << full_path << RESET << std::endl;
+                }
+                started = true;
+            });
+        #endif
+    }
+
+    void benchmarkExecutable(const std::string& name) {
+        std::string full_path = buildExecutablePath(name);
+        if (!fs::exists(full_path)) {
+            throw std::runtime_error("File not found: " + full_path + "; build it first");
+        }
+        std::string baseline = bench_.baseline.empty() ? buildDirectory() + "/bench/" + name + ".json" : bench_.baseline;
+        Benchmark(bench_).run(full_path, baseline);
+    }
+
     int runExecutable(const std::string& name) {
         std::string full_path = buildExecutablePath(name);
 
@@ -49,7 +116,9 @@ public:
 
         std::cout << BLUE << "▶️ Running: " << full_path << RESET << std::endl;
 
-        int result = std::system(full_path.c_str());
+        ProcessOptions options;
+        options.capture = false;
+        int result = runProcess({full_path}, options).exit_code;
 
         if (result == 0) {
             std::cout << GREEN << "✅ Succes" << RESET << std::endl;
@@ -60,7 +129,7 @@ public:
         return result;
     }
     std::string buildExecutablePath(const std::string& name) {
-        std::string full_path = "build/" + name;
+        std::string full_path = buildDirectory() + "/" + name;
 
         #ifdef _WIN32
             full_path += ".exe";
@@ -68,6 +137,32 @@ public:
 
         return full_path;
     }
+
+private:
+    BuildOptions options_;
+    std::string target_;
+    BenchOptions bench_;
+
+    std::string buildDirectory() const {
+        return "build/" + variantDirectory(options_.profile, options_.sanitize, options_.coverage);
+    }
+
+    // The executable target named after the project, else the first one
+    // declared; projects without "targets" build just that one.
+    static std::string defaultTarget(const json& config) {
+        std::string name = config.value("name", "Unnamed Project");
+        if (!config.contains("targets")) return name;
+
+        const json& targets = config["targets"];
+        auto isExecutable = [&](const std::string& target) {
+            return targets.contains(target) && targets[target].value("type", "executable") == "executable";
+        };
+        if (isExecutable(name)) return name;
+        for (const auto& [target, entry] : targets.items()) {
+            if (isExecutable(target)) return target;
+        }
+        return name;
+    }
 };
 
 #endif
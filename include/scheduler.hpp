@@ -0,0 +1,149 @@
+#ifndef QUICK_CPPKG_SCHEDULER_HPP
+#define QUICK_CPPKG_SCHEDULER_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct JobResult {
+    bool ok = true;
+    std::string output;
+};
+
+// Runs queued jobs on a bounded pool of worker threads. A job may name jobs
+// it has to wait for, so a dependency graph runs in topological order with
+// independent jobs in parallel. Each job's output is printed in one piece
+// once it finishes, and after the first failure (a job returning !ok or
+// throwing) no new jobs are started.
+class JobScheduler {
+public:
+    explicit JobScheduler(size_t workers) : workers_(workers) {
+        if (workers_ == 0) {
+            workers_ = std::max(1u, std::thread::hardware_concurrency());
+        }
+    }
+
+    // Returns an id that later jobs can list in `after`.
+    size_t add(std::function<JobResult()> job, const std::vector<size_t>& after = {}) {
+        size_t id = jobs_.size();
+        jobs_.push_back({std::move(job), after.size(), {}});
+        for (size_t dependency : after) {
+            jobs_[dependency].dependents.push_back(id);
+        }
+        return id;
+    }
+
+    bool run() {
+        failed_ = false;
+        finished_ = 0;
+        running_ = 0;
+        ready_.clear();
+        for (size_t id = 0; id < jobs_.size(); ++id) {
+            if (jobs_[id].pending == 0) ready_.push_back(id);
+        }
+
+        size_t count = std::min(workers_, jobs_.size());
+
+        std::vector<std::thread> threads;
+        threads.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            threads.emplace_back([this, i]() {
+                workerIndex() = i + 1;
+                work();
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        // Jobs left unfinished (after a failure, or in a cycle) count as failed.
+        bool ok = !failed_ && finished_ == jobs_.size();
+        jobs_.clear();
+        return ok;
+    }
+
+    size_t workers() const { return workers_; }
+
+    // The worker running the calling job, counted from 1; 0 outside a job.
+    static size_t currentWorker() { return workerIndex(); }
+
+private:
+    struct Job {
+        std::function<JobResult()> run;
+        size_t pending;
+        std::vector<size_t> dependents;
+    };
+
+    size_t workers_;
+    std::vector<Job> jobs_;
+    std::deque<size_t> ready_;
+    size_t finished_ = 0;
+    size_t running_ = 0;
+    bool failed_ = false;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::mutex output_mutex_;
+
+    static size_t& workerIndex() {
+        static thread_local size_t index = 0;
+        return index;
+    }
+
+    // A job that throws fails like one that returned !ok, with the
+    // exception's message as its output.
+    static JobResult runJob(Job& job) {
+        try {
+            return job.run();
+        } catch (const std::exception& e) {
+            return {false, std::string("\033[31m❌ ") + e.what() + "\033[0m\n"};
+        } catch (...) {
+            return {false, "\033[31m❌ Job failed with an unknown exception\033[0m\n"};
+        }
+    }
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            wake_.wait(lock, [this]() {
+                return failed_ || !ready_.empty() || running_ == 0;
+            });
+            if (failed_ || ready_.empty()) {
+                wake_.notify_all();
+                return;
+            }
+
+            size_t id = ready_.front();
+            ready_.pop_front();
+            ++running_;
+            lock.unlock();
+
+            JobResult result = runJob(jobs_[id]);
+
+            if (!result.output.empty()) {
+                std::lock_guard<std::mutex> output_lock(output_mutex_);
+                (result.ok ? std::cout : std::cerr) << result.output << std::flush;
+            }
+
+            lock.lock();
+            --running_;
+            ++finished_;
+            if (!result.ok) {
+                failed_ = true;
+            } else {
+                for (size_t dependent : jobs_[id].dependents) {
+                    if (--jobs_[dependent].pending == 0) ready_.push_back(dependent);
+                }
+            }
+            wake_.notify_all();
+        }
+    }
+};
+
+#endif
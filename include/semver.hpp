@@ -0,0 +1,224 @@
+#ifndef QUICK_CPPKG_SEMVER_HPP
+#define QUICK_CPPKG_SEMVER_HPP
+
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+struct Version {
+    int major = 0;
+    int minor = 0;
+    int patch = 0;
+    std::string prerelease;
+
+    // Accepts "1.2.3" and "1.2.3-rc.1"; build metadata after '+' is ignored.
+    static std::optional<Version> parse(const std::string& text) {
+        Version version;
+        int parts = 0;
+        if (!parsePartial(text, version, parts) || parts != 3) return std::nullopt;
+        return version;
+    }
+
+    // Like parse() but allows "1" and "1.2"; `parts` receives how many of
+    // major/minor/patch were present.
+    static bool parsePartial(std::string text, Version& version, int& parts) {
+        version = {};
+        parts = 0;
+
+        size_t plus = text.find('+');
+        if (plus != std::string::npos) text.erase(plus);
+
+        size_t dash = text.find('-');
+        if (dash != std::string::npos) {
+            version.prerelease = text.substr(dash + 1);
+            text.erase(dash);
+            if (version.prerelease.empty()) return false;
+        }
+
+        int* fields[] = {&version.major, &version.minor, &version.patch};
+        size_t pos = 0;
+        while (true) {
+            size_t end = text.find('.', pos);
+            std::string field = text.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+            if (field.empty() || field.size() > 9 || field.find_first_not_of("0123456789") != std::string::npos) {
+                return false;
+            }
+            *fields[parts++] = std::stoi(field);
+            if (end == std::string::npos) return true;
+            if (parts == 3) return false;
+            pos = end + 1;
+        }
+    }
+
+    std::string toString() const {
+        std::string text = std::to_string(major) + "." + std::to_string(minor) + "." + std::to_string(patch);
+        if (!prerelease.empty()) text += "-" + prerelease;
+        return text;
+    }
+
+    bool operator==(const Version& other) const {
+        return std::tie(major, minor, patch, prerelease) == std::tie(other.major, other.minor, other.patch, other.prerelease);
+    }
+    bool operator!=(const Version& other) const { return !(*this == other); }
+
+    // A prerelease sorts before its release; prerelease tags compare as strings.
+    bool operator<(const Version& other) const {
+        if (std::tie(major, minor, patch) != std::tie(other.major, other.minor, other.patch)) {
+            return std::tie(major, minor, patch) < std::tie(other.major, other.minor, other.patch);
+        }
+        if (prerelease.empty() != other.prerelease.empty()) return !prerelease.empty();
+        return prerelease < other.prerelease;
+    }
+    bool operator>(const Version& other) const { return other < *this; }
+    bool operator<=(const Version& other) const { return !(other < *this); }
+    bool operator>=(const Version& other) const { return !(*this < other); }
+};
+
+// A version requirement in the usual npm/Cargo syntax:
+//   "1.2.3"  "=1.2.3"  "^1.2"  "~1.2.3"  ">=1.0 <2.0"  "1.x"  "*"  "a || b"
+// A bare version means caret ("^"), as in Cargo. Prereleases only match
+// when a comparator names a prerelease of the same major.minor.patch.
+class VersionConstraint {
+public:
+    VersionConstraint() = default;
+
+    static VersionConstraint parse(const std::string& text) {
+        VersionConstraint constraint;
+        constraint.text_ = text;
+
+        size_t pos = 0;
+        while (true) {
+            size_t bar = text.find("||", pos);
+            constraint.alternatives_.push_back(parseRange(text.substr(pos, bar == std::string::npos ? std::string::npos : bar - pos), text));
+            if (bar == std::string::npos) break;
+            pos = bar + 2;
+        }
+        return constraint;
+    }
+
+    bool matches(const Version& version) const {
+        if (alternatives_.empty()) return version.prerelease.empty();
+
+        for (const auto& range : alternatives_) {
+            bool ok = true;
+            bool allows_prerelease = false;
+            for (const auto& comparator : range) {
+                if (!comparator.matches(version)) {
+                    ok = false;
+                    break;
+                }
+                const Version& bound = comparator.version;
+                if (!bound.prerelease.empty() && bound.major == version.major &&
+                    bound.minor == version.minor && bound.patch == version.patch) {
+                    allows_prerelease = true;
+                }
+            }
+            if (ok && (version.prerelease.empty() || allows_prerelease)) return true;
+        }
+        return false;
+    }
+
+    const std::string& text() const { return text_; }
+
+private:
+    enum class Op { Eq, Lt, Le, Gt, Ge };
+
+    struct Comparator {
+        Op op;
+        Version version;
+
+        bool matches(const Version& v) const {
+            switch (op) {
+                case Op::Eq: return v == version;
+                case Op::Lt: return v < version;
+                case Op::Le: return v <= version;
+                case Op::Gt: return v > version;
+                case Op::Ge: return v >= version;
+            }
+            return false;
+        }
+    };
+
+    using Range = std::vector<Comparator>;
+
+    std::string text_;
+    std::vector<Range> alternatives_; // empty = any release
+
+    static Range parseRange(const std::string& text, const std::string& whole) {
+        Range range;
+        size_t pos = 0;
+
+        while (pos < text.size()) {
+            while (pos < text.size() && (text[pos] == ' ' || text[pos] == ',')) ++pos;
+            if (pos >= text.size()) break;
+
+            size_t start = pos;
+            while (pos < text.size() && std::string("<>=^~").find(text[pos]) != std::string::npos) ++pos;
+            std::string op = text.substr(start, pos - start);
+            while (pos < text.size() && text[pos] == ' ') ++pos;
+
+            size_t end = text.find_first_of(" ,", pos);
+            std::string version = text.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+            pos = end == std::string::npos ? text.size() : end;
+
+            addComparators(range, op, version, whole);
+        }
+
+        return range;
+    }
+
+    static void addComparators(Range& range, const std::string& op, std::string text, const std::string& whole) {
+        if (op.empty() && (text == "*" || text == "latest" || text == "x")) return;
+
+        // "1.x" / "1.2.*" are partial versions.
+        for (const char* wildcard : {".x", ".X", ".*"}) {
+            size_t at = text.find(wildcard);
+            if (at != std::string::npos) text.erase(at);
+        }
+
+        Version v;
+        int parts = 0;
+        if (!Version::parsePartial(text, v, parts)) {
+            throw std::runtime_error("Invalid version constraint '" + whole + "'");
+        }
+
+        auto bump = [&](int field) {
+            Version next;
+            if (field == 0) next.major = v.major + 1;
+            if (field == 1) { next.major = v.major; next.minor = v.minor + 1; }
+            if (field == 2) { next.major = v.major; next.minor = v.minor; next.patch = v.patch + 1; }
+            return next;
+        };
+
+        if (op == "^" || op.empty()) {
+            // Everything up to the first non-zero field is fixed.
+            int fixed = v.major != 0 || parts == 1 ? 0 : (v.minor != 0 || parts == 2 ? 1 : 2);
+            range.push_back({Op::Ge, v});
+            range.push_back({Op::Lt, bump(fixed)});
+        } else if (op == "~") {
+            range.push_back({Op::Ge, v});
+            range.push_back({Op::Lt, bump(parts == 1 ? 0 : 1)});
+        } else if (op == "=" || op == "==") {
+            if (parts == 3) {
+                range.push_back({Op::Eq, v});
+            } else {
+                range.push_back({Op::Ge, v});
+                range.push_back({Op::Lt, bump(parts - 1)});
+            }
+        } else if (op == ">=") {
+            range.push_back({Op::Ge, v});
+        } else if (op == ">") {
+            range.push_back(parts == 3 ? Comparator{Op::Gt, v} : Comparator{Op::Ge, bump(parts - 1)});
+        } else if (op == "<") {
+            range.push_back({Op::Lt, v});
+        } else if (op == "<=") {
+            range.push_back(parts == 3 ? Comparator{Op::Le, v} : Comparator{Op::Lt, bump(parts - 1)});
+        } else {
+            throw std::runtime_error("Invalid version constraint '" + whole + "'");
+        }
+    }
+};
+
+#endif
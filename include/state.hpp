@@ -0,0 +1,281 @@
+#ifndef QUICK_CPPKG_STATE_HPP
+#define QUICK_CPPKG_STATE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+struct DirectoryRecord {
+    int64_t mtime = 0;
+    std::vector<std::string> files;
+    std::vector<std::string> subdirs;
+};
+
+struct PrerequisiteRecord {
+    std::string path;
+    int64_t mtime = 0;
+    uint64_t size = 0;
+    std::string hash;
+};
+
+// What an object was last built from: the hash of its command line and the
+// exact state of every file listed in its depfile.
+struct StepRecord {
+    std::string command_hash;
+    std::vector<PrerequisiteRecord> prerequisites;
+};
+
+// Build state persisted in build/ between invocations, so that neither the
+// source tree nor the depfiles have to be re-read on every build.
+class BuildState {
+public:
+    std::unordered_map<std::string, DirectoryRecord> directories;
+    std::unordered_map<std::string, StepRecord> steps; // keyed by object path
+
+    bool load(const std::string& path) {
+        directories.clear();
+        steps.clear();
+
+        std::string_view data;
+        #ifdef _WIN32
+            std::ifstream file(path, std::ios::binary);
+            if (!file) return false;
+            std::stringstream buffer;
+            buffer << file.rdbuf();
+            std::string content = buffer.str();
+            data = content;
+            return decode(data);
+        #else
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return false;
+
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_size == 0) {
+                close(fd);
+                return false;
+            }
+
+            void* map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (map == MAP_FAILED) return false;
+
+            data = std::string_view(static_cast<const char*>(map), static_cast<size_t>(st.st_size));
+            bool ok = decode(data);
+            munmap(map, static_cast<size_t>(st.st_size));
+            return ok;
+        #endif
+    }
+
+    bool save(const std::string& path) const {
+        std::string out(kMagic, sizeof(kMagic));
+
+        putU32(out, static_cast<uint32_t>(directories.size()));
+        for (const auto& [dir, record] : directories) {
+            putString(out, dir);
+            putI64(out, record.mtime);
+            putStrings(out, record.files);
+            putStrings(out, record.subdirs);
+        }
+
+        putU32(out, static_cast<uint32_t>(steps.size()));
+        for (const auto& [object, record] : steps) {
+            putString(out, object);
+            putString(out, record.command_hash);
+            putU32(out, static_cast<uint32_t>(record.prerequisites.size()));
+            for (const auto& prerequisite : record.prerequisites) {
+                putString(out, prerequisite.path);
+                putI64(out, prerequisite.mtime);
+                putU64(out, prerequisite.size);
+                putString(out, prerequisite.hash);
+            }
+        }
+
+        std::string tmp = path + ".tmp";
+        {
+            std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+            if (!file.write(out.data(), static_cast<std::streamsize>(out.size()))) return false;
+        }
+
+        std::error_code ec;
+        fs::rename(tmp, path, ec);
+        return !ec;
+    }
+
+private:
+    static constexpr char kMagic[8] = {'C', 'P', 'K', 'G', 'S', 'T', '0', '1'};
+
+    static void putU32(std::string& out, uint32_t value) { out.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+    static void putU64(std::string& out, uint64_t value) { out.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+    static void putI64(std::string& out, int64_t value) { out.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+
+    static void putString(std::string& out, const std::string& value) {
+        putU32(out, static_cast<uint32_t>(value.size()));
+        out += value;
+    }
+
+    static void putStrings(std::string& out, const std::vector<std::string>& values) {
+        putU32(out, static_cast<uint32_t>(values.size()));
+        for (const auto& value : values) putString(out, value);
+    }
+
+    // Bounds-checked reader over the mapped file.
+    struct Reader {
+        std::string_view data;
+        size_t pos = 0;
+        bool ok = true;
+
+        template <typename T>
+        T number() {
+            T value{};
+            if (pos + sizeof(T) > data.size()) {
+                ok = false;
+                return value;
+            }
+            std::memcpy(&value, data.data() + pos, sizeof(T));
+            pos += sizeof(T);
+            return value;
+        }
+
+        std::string string() {
+            uint32_t size = number<uint32_t>();
+            if (!ok || pos + size > data.size()) {
+                ok = false;
+                return {};
+            }
+            std::string value(data.substr(pos, size));
+            pos += size;
+            return value;
+        }
+
+        std::vector<std::string> strings() {
+            uint32_t count = number<uint32_t>();
+            std::vector<std::string> values;
+            for (uint32_t i = 0; ok && i < count; ++i) values.push_back(string());
+            return values;
+        }
+    };
+
+    bool decode(std::string_view data) {
+        if (data.size() < sizeof(kMagic) || data.substr(0, sizeof(kMagic)) != std::string_view(kMagic, sizeof(kMagic))) {
+            return false;
+        }
+
+        Reader reader{data, sizeof(kMagic)};
+
+        uint32_t dir_count = reader.number<uint32_t>();
+        for (uint32_t i = 0; reader.ok && i < dir_count; ++i) {
+            std::string dir = reader.string();
+            DirectoryRecord record;
+            record.mtime = reader.number<int64_t>();
+            record.files = reader.strings();
+            record.subdirs = reader.strings();
+            directories.emplace(std::move(dir), std::move(record));
+        }
+
+        uint32_t step_count = reader.number<uint32_t>();
+        for (uint32_t i = 0; reader.ok && i < step_count; ++i) {
+            std::string object = reader.string();
+            StepRecord record;
+            record.command_hash = reader.string();
+            uint32_t count = reader.number<uint32_t>();
+            for (uint32_t j = 0; reader.ok && j < count; ++j) {
+                PrerequisiteRecord prerequisite;
+                prerequisite.path = reader.string();
+                prerequisite.mtime = reader.number<int64_t>();
+                prerequisite.size = reader.number<uint64_t>();
+                prerequisite.hash = reader.string();
+                record.prerequisites.push_back(std::move(prerequisite));
+            }
+            steps.emplace(std::move(object), std::move(record));
+        }
+
+        if (!reader.ok) {
+            directories.clear();
+            steps.clear();
+        }
+        return reader.ok;
+    }
+};
+
+inline int64_t fileTimeTicks(fs::file_time_type time) {
+    return static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+// Directories that never contain project sources and are not descended into:
+// version-control and editor metadata at any depth, and build output and
+// fetched packages only next to cppkg.json. `path` is relative to the project
+// root, so a vendored library's own build/ or src/build/ is still scanned.
+inline bool isIgnoredDirectory(const fs::path& path) {
+    static const char* const kMetadata[] = {".git", ".hg", ".svn", ".bzr", ".cache", ".idea", ".vs", ".vscode"};
+    fs::path normalized = path.lexically_normal();
+    std::string name = normalized.filename().string();
+    for (const char* metadata : kMetadata) {
+        if (name == metadata) return true;
+    }
+    if (!normalized.parent_path().empty()) return false;
+    return name == "build" || name == "_packages" || name.rfind("cmake-build", 0) == 0;
+}
+
+// Lists every regular file below `root`. A directory is only re-read when its
+// mtime differs from the one recorded in `state`; otherwise its listing is
+// taken from the state, so an unchanged tree costs one stat per directory.
+inline std::vector<std::string> scanTree(const std::string& root, BuildState& state) {
+    std::unordered_map<std::string, DirectoryRecord> scanned;
+    std::vector<std::string> files;
+    std::vector<std::string> pending = {root};
+
+    while (!pending.empty()) {
+        std::string dir = std::move(pending.back());
+        pending.pop_back();
+
+        std::error_code ec;
+        int64_t mtime = fileTimeTicks(fs::last_write_time(dir, ec));
+        if (ec) continue;
+
+        DirectoryRecord record;
+        auto cached = state.directories.find(dir);
+        if (cached != state.directories.end() && cached->second.mtime == mtime) {
+            record = std::move(cached->second);
+        } else {
+            record.mtime = mtime;
+            for (const auto& entry : fs::directory_iterator(dir, ec)) {
+                std::string name = entry.path().filename().string();
+                std::error_code type_ec;
+                if (entry.is_directory(type_ec)) {
+                    if (!isIgnoredDirectory(dir + "/" + name)) record.subdirs.push_back(name);
+                } else if (entry.is_regular_file(type_ec)) {
+                    record.files.push_back(name);
+                }
+            }
+        }
+
+        for (const auto& name : record.files) {
+            files.push_back(dir + "/" + name);
+        }
+        for (const auto& name : record.subdirs) {
+            pending.push_back(dir + "/" + name);
+        }
+
+        scanned.emplace(std::move(dir), std::move(record));
+    }
+
+    state.directories = std::move(scanned);
+    return files;
+}
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef QUICK_CPPKG_TARGET_HPP
+#define QUICK_CPPKG_TARGET_HPP
+
+#include "includes.hpp"
+#include "modules.hpp"
+#include "nlohmann/json.hpp"
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+// One thing a project builds. Projects without "targets" in cppkg.json
+// have a single executable named after the project.
+struct Target {
+    std::string name;
+    std::string type = "executable"; // "executable", "test", "static" or "shared"
+    std::vector<std::string> sources;
+    std::vector<std::string> deps;   // targets of the same project it links against
+    IncludeDirs include_dirs;        // none declared: the project-wide include path
+
+    bool isLibrary() const { return type == "static" || type == "shared"; }
+    bool isExecutable() const { return type == "executable" || type == "test"; }
+};
+
+// Where a target's binary ends up inside `out_dir`.
+inline std::string targetOutput(const Target& target, const std::string& out_dir, bool msvc) {
+    std::string base = out_dir + "/";
+    if (target.type == "static") {
+        return base + (msvc ? target.name + ".lib" : "lib" + target.name + ".a");
+    }
+    if (target.type == "shared") {
+        #ifdef _WIN32
+            return base + target.name + ".dll";
+        #elif __APPLE__
+            return base + "lib" + target.name + ".dylib";
+        #else
+            return base + "lib" + target.name + ".so";
+        #endif
+    }
+    #ifdef _WIN32
+        return base + target.name + ".exe";
+    #else
+        return base + target.name;
+    #endif
+}
+
+// A "sources" entry is a file, or a directory standing for every .cpp and
+// module interface (.cppm, .ixx) below it in `tree`.
+inline std::vector<std::string> expandSources(const std::vector<std::string>& entries, const std::vector<std::string>& tree) {
+    std::vector<std::string> sources;
+    std::set<std::string> seen;
+
+    for (const auto& entry : entries) {
+        std::string wanted = fs::path(entry).lexically_normal().generic_string();
+        if (!wanted.empty() && wanted.back() == '/') wanted.pop_back();
+
+        if (!fs::is_directory(wanted)) {
+            if (fs::exists(wanted) && seen.insert(wanted).second) sources.push_back(wanted);
+            continue;
+        }
+
+        for (const auto& file : tree) {
+            fs::path path = fs::path(file).lexically_normal();
+            std::string normalized = path.generic_string();
+            bool inside = wanted == "." || normalized.rfind(wanted + "/", 0) == 0;
+            if (inside && (path.extension() == ".cpp" || isModuleInterfaceFile(path)) && seen.insert(normalized).second) {
+                sources.push_back(normalized);
+            }
+        }
+    }
+    return sources;
+}
+
+// The "targets" object of cppkg.json, e.g.
+//
+//   "targets": {
+//     "core": {"type": "static", "sources": ["src/core"], "include_dirs": {"public": ["src/core/include"]}},
+//     "app":  {"type": "executable", "sources": ["src/main.cpp"], "deps": ["core"]}
+//   }
+//
+// Targets are returned in dependency order: each after the ones it uses.
+inline std::vector<Target> loadTargets(const json& config, const std::vector<std::string>& tree) {
+    std::map<std::string, Target> declared;
+    for (const auto& [name, entry] : config["targets"].items()) {
+        Target target;
+        target.name = name;
+        target.type = entry.value("type", "executable");
+        if (!target.isLibrary() && !target.isExecutable()) {
+            throw std::runtime_error("Target '" + name + "' has unknown type '" + target.type +
+                                     "' (expected executable, test, static or shared)");
+        }
+        target.sources = expandSources(entry.value("sources", std::vector<std::string>{}), tree);
+        if (target.sources.empty()) {
+            throw std::runtime_error("Target '" + name + "' has no sources");
+        }
+        target.deps = entry.value("deps", std::vector<std::string>{});
+        if (entry.contains("include_dirs")) target.include_dirs = IncludeDirs::parse(entry["include_dirs"]);
+        declared.emplace(name, std::move(target));
+    }
+
+    std::vector<Target> ordered;
+    std::set<std::string> done;
+    std::set<std::string> visiting;
+
+    std::function<void(const std::string&, const std::string&)> visit = [&](const std::string& name, const std::string& from) {
+        auto it = declared.find(name);
+        if (it == declared.end()) {
+            throw std::runtime_error("Target '" + from + "' depends on unknown target '" + name + "'");
+        }
+        if (done.count(name)) return;
+        if (!visiting.insert(name).second) {
+            throw std::runtime_error("Targets '" + from + "' and '" + name + "' depend on each other");
+        }
+        for (const auto& dep : it->second.deps) {
+            auto used = declared.find(dep);
+            if (used != declared.end() && !used->second.isLibrary()) {
+                throw std::runtime_error("Target '" + name + "' depends on '" + dep + "', which is not a library");
+            }
+            visit(dep, name);
+        }
+        visiting.erase(name);
+        done.insert(name);
+        ordered.push_back(it->second);
+    };
+
+    for (const auto& [name, target] : declared) {
+        visit(name, name);
+    }
+    return ordered;
+}
+
+#endif
@@ -0,0 +1,581 @@
+#ifndef QUICK_CPPKG_TEST_HPP
+#define QUICK_CPPKG_TEST_HPP
+
+#include "build.hpp"
+#include "command.hpp"
+#include "hash.hpp"
+#include "nlohmann/json.hpp"
+#include "process.hpp"
+#include "scheduler.hpp"
+#include "state.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+constexpr int kDefaultTestTimeout = 300; // seconds
+
+// `--shard=i/n`: the i-th of n slices of the test cases, counted from 1.
+struct TestShard {
+    size_t index = 1;
+    size_t count = 1;
+
+    static TestShard parse(const std::string& text) {
+        TestShard shard;
+        size_t slash = text.find('/');
+        try {
+            size_t used = 0;
+            if (slash == std::string::npos) throw std::invalid_argument(text);
+            shard.index = std::stoul(text.substr(0, slash), &used);
+            if (used != slash) throw std::invalid_argument(text);
+            shard.count = std::stoul(text.substr(slash + 1), &used);
+            if (used != text.size() - slash - 1) throw std::invalid_argument(text);
+        } catch (const std::exception&) {
+            throw std::runtime_error("Invalid shard '" + text + "', expected i/n such as 2/4");
+        }
+        if (shard.count == 0 || shard.index == 0 || shard.index > shard.count) {
+            throw std::runtime_error("Invalid shard '" + text + "': i must be between 1 and n");
+        }
+        return shard;
+    }
+};
+
+// The test framework a binary was linked with, recognised by the names of
+// its command line flags: "gtest", "catch2" (Catch2 v3), "catch2-v2",
+// "doctest", or "" for a plain program that is run as one test.
+inline std::string detectTestFramework(const std::string& binary) {
+    std::ifstream file(binary, std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (contents.find("gtest_list_tests") != std::string::npos) return "gtest";
+    if (contents.find("list-test-cases") != std::string::npos) return "doctest";
+    if (contents.find("list-test-names-only") != std::string::npos) return "catch2-v2";
+    if (contents.find("list-reporters") != std::string::npos) return "catch2";
+    return "";
+}
+
+inline std::vector<std::string> testListCommand(const std::string& framework, const std::string& binary) {
+    if (framework == "gtest") return {binary, "--gtest_list_tests"};
+    if (framework == "catch2-v2") return {binary, "--list-test-names-only"};
+    if (framework == "catch2") return {binary, "--list-tests", "--verbosity", "quiet"};
+    if (framework == "doctest") return {binary, "--list-test-cases", "--no-version"};
+    return {};
+}
+
+// Test case names from the output of testListCommand(). Disabled gtest
+// cases and hidden Catch2 cases are not listed, so they are never run.
+inline std::vector<std::string> parseTestList(const std::string& framework, const std::string& output) {
+    std::vector<std::string> cases;
+    std::istringstream lines(output);
+    std::string line;
+    std::string suite;
+    while (std::getline(lines, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.find_first_not_of(" \t") == std::string::npos) continue;
+
+        if (framework == "gtest") {
+            // "Suite." lines, each followed by "  Case" lines; either may
+            // carry a "  # GetParam() = ..." comment.
+            std::string name = line.substr(0, line.find("  #"));
+            name = name.substr(0, name.find_last_not_of(' ') + 1);
+            if (line[0] != ' ') {
+                suite = !name.empty() && name.back() == '.' ? name : "";
+                continue;
+            }
+            name = name.substr(name.find_first_not_of(' '));
+            std::string suite_name = suite.substr(suite.rfind('/') + 1);
+            if (suite.empty() || name.rfind("DISABLED_", 0) == 0 || suite_name.rfind("DISABLED_", 0) == 0) continue;
+            cases.push_back(suite + name);
+        } else if (framework == "doctest") {
+            if (line.rfind("[doctest]", 0) == 0 || line.rfind("=====", 0) == 0) continue;
+            cases.push_back(line);
+        } else {
+            cases.push_back(line);
+        }
+    }
+    return cases;
+}
+
+// The command running the single case `name` of `binary`. Catch2 and
+// doctest treat commas, brackets and wildcards in a filter specially, so
+// those are escaped.
+inline std::vector<std::string> testCaseCommand(const std::string& framework, const std::string& binary,
+                                                const std::string& name) {
+    if (name.empty()) return {binary};
+    if (framework == "gtest") return {binary, "--gtest_filter=" + name};
+
+    std::string escaped;
+    for (char c : name) {
+        bool special = framework == "doctest" ? c == ',' || c == '\\'
+                                              : std::string("\\,[]\"*~").find(c) != std::string::npos;
+        if (special) escaped += '\\';
+        escaped += c;
+    }
+    if (framework == "doctest") return {binary, "--test-case=" + escaped, "--no-version"};
+    return {binary, escaped};
+}
+
+inline std::string xmlEscape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        switch (c) {
+            case '&': escaped += "&amp;"; break;
+            case '<': escaped += "&lt;"; break;
+            case '>': escaped += "&gt;"; break;
+            case '"': escaped += "&quot;"; break;
+            case '\'': escaped += "&apos;"; break;
+            default:
+                // XML 1.0 has no way to spell other control characters,
+                // such as the escape starting a terminal colour.
+                if (static_cast<unsigned char>(c) >= 0x20 || c == '\t' || c == '\n' || c == '\r') escaped += c;
+        }
+    }
+    return escaped;
+}
+
+// `cppkg test`: builds the project, lists the cases of every "test" target
+// and runs each case as its own process on a pool of workers. A case whose
+// binary, shared libraries and declared inputs are byte-identical to the
+// last time it passed is not run again. Results go to a JUnit XML report.
+//
+// Test targets may set, in cppkg.json:
+//
+//   "unit": {"type": "test", "sources": ["tests"], "deps": ["core"],
+//            "inputs": ["tests/data"], "timeout": 60}
+//
+// "inputs" are files or directories the tests read; "timeout" is in seconds
+// per case.
+class TestHandler : public CommandHandler {
+public:
+    struct Options {
+        BuildOptions build;
+        std::vector<std::string> targets; // test targets to run; all when empty
+        std::string shard;                // "i/n", or "" for all cases
+        int timeout = 0;                  // seconds per case; 0 = the target's, else kDefaultTestTimeout
+        bool rerun = false;               // also run cases that passed before with identical inputs
+        std::string junit;                // report path; "" = <build dir>/test-results.xml
+    };
+
+    explicit TestHandler(Options options) : options_(std::move(options)) {}
+
+    void execute() override {
+        TestShard shard = options_.shard.empty() ? TestShard{} : TestShard::parse(options_.shard);
+        json config = json::parse(std::ifstream("cppkg.json"));
+
+        BuildHandler builder(options_.build);
+        if (!builder.buildOnce()) {
+            throw std::runtime_error("Tests were not run because the build failed");
+        }
+        out_dir_ = builder.outputDirectory();
+        state_path_ = out_dir_ + "/tests.json";
+        loadState();
+
+        std::vector<BuildHandler::Output> binaries = testBinaries(builder.outputs());
+        if (binaries.empty()) {
+            std::cout << YELLOW << "⚠️  No test targets; declare one in cppkg.json with \"type\": \"test\"" << RESET
+                      << std::endl;
+            return;
+        }
+
+        if (options_.build.coverage) {
+            // clang's instrumented binaries honour this; gcc's ignore it.
+            std::string pattern = fs::absolute(out_dir_ + "/coverage/%p.profraw").string();
+            fs::create_directories(out_dir_ + "/coverage");
+            #ifdef _WIN32
+                _putenv_s("LLVM_PROFILE_FILE", pattern.c_str());
+            #else
+                setenv("LLVM_PROFILE_FILE", pattern.c_str(), 1);
+            #endif
+        }
+
+        std::vector<TestCase> cases = discover(binaries, config);
+        std::sort(cases.begin(), cases.end(), [](const TestCase& a, const TestCase& b) {
+            return a.target != b.target ? a.target < b.target : a.name < b.name;
+        });
+        if (shard.count > 1) {
+            std::vector<TestCase> slice;
+            for (size_t i = shard.index - 1; i < cases.size(); i += shard.count) {
+                slice.push_back(cases[i]);
+            }
+            cases = std::move(slice);
+        }
+
+        run(cases, shard);
+        writeJUnit(cases, options_.junit.empty() ? out_dir_ + "/test-results.xml" : options_.junit);
+        saveState();
+        report(cases);
+    }
+
+private:
+    static constexpr std::chrono::seconds kListTimeout{60};
+
+    struct TestCase {
+        std::string target;
+        std::string name; // "" for a binary that is run as a whole
+        std::vector<std::string> command;
+        std::string key;  // changes whenever the binary, its libraries or inputs do
+        std::chrono::seconds timeout{0};
+        double last_seconds = -1; // from the previous run, -1 if unknown
+
+        // Filled in by run().
+        std::string status;       // "passed", "failed", "timed out" or "cached"
+        int exit_code = 0;
+        double seconds = 0;
+        std::string output;
+
+        std::string label() const { return name.empty() ? target : target + ": " + name; }
+    };
+
+    Options options_;
+    std::string out_dir_;
+    std::string state_path_;
+    // build/<variant>/tests.json: file hashes, the cases each binary listed,
+    // and for every case the key it last passed with and how long it took.
+    json state_ = json::object();
+
+    std::vector<BuildHandler::Output> testBinaries(const std::vector<BuildHandler::Output>& outputs) const {
+        std::vector<BuildHandler::Output> binaries;
+        std::set<std::string> wanted(options_.targets.begin(), options_.targets.end());
+        for (const auto& output : outputs) {
+            if (output.target.type != "test") continue;
+            if (!wanted.empty() && !wanted.erase(output.target.name)) continue;
+            binaries.push_back(output);
+        }
+        if (!wanted.empty()) {
+            throw std::runtime_error("'" + *wanted.begin() + "' is not a test target");
+        }
+        return binaries;
+    }
+
+    // Lists the cases of every binary, running the binaries whose lists are
+    // not known yet in parallel.
+    std::vector<TestCase> discover(const std::vector<BuildHandler::Output>& binaries, const json& config) {
+        struct Listing {
+            const BuildHandler::Output* output;
+            std::string binary_key;
+            std::string inputs_key;
+            std::string framework;
+            std::vector<std::string> cases;
+            std::chrono::seconds timeout;
+        };
+        std::vector<Listing> listings;
+        JobScheduler scheduler(options_.build.jobs);
+
+        for (const auto& output : binaries) {
+            const std::string& name = output.target.name;
+            json entry = config.contains("targets") ? config["targets"].value(name, json::object()) : json::object();
+
+            Listing listing{&output, "", "", "", {}, std::chrono::seconds(kDefaultTestTimeout)};
+            if (options_.timeout > 0) {
+                listing.timeout = std::chrono::seconds(options_.timeout);
+            } else if (entry.contains("timeout")) {
+                listing.timeout = std::chrono::seconds(entry["timeout"].get<int>());
+            }
+
+            std::string binary_key = hashFileCached(output.binary);
+            for (const auto& library : output.shared_libraries) {
+                binary_key += hashFileCached(library);
+            }
+            listing.binary_key = sha256(binary_key);
+
+            std::string inputs_key;
+            for (const auto& input : entry.value("inputs", std::vector<std::string>{})) {
+                for (const auto& file : inputFiles(input)) {
+                    inputs_key += file + "\n" + hashFileCached(file) + "\n";
+                }
+            }
+            listing.inputs_key = sha256(inputs_key);
+
+            const json& known = member(state_["binaries"], name);
+            if (known.value("key", "") == listing.binary_key) {
+                listing.framework = known.value("framework", "");
+                listing.cases = known.value("cases", std::vector<std::string>{});
+            }
+            listings.push_back(std::move(listing));
+        }
+
+        for (auto& listing : listings) {
+            if (member(state_["binaries"], listing.output->target.name).value("key", "") == listing.binary_key) continue;
+            Listing* current = &listing;
+            scheduler.add([current]() {
+                JobResult job;
+                current->framework = detectTestFramework(current->output->binary);
+                if (current->framework.empty()) return job;
+
+                ProcessOptions options;
+                options.timeout = kListTimeout;
+                // Catch2 v2 exits with the number of tests it listed.
+                ProcessResult listed = runProcess(testListCommand(current->framework, current->output->binary), options);
+                if (listed.timed_out || (listed.exit_code != 0 && current->framework != "catch2-v2")) {
+                    job.output = YELLOW + std::string("⚠️  Could not list the tests of ") + current->output->binary +
+                                 ", running it as a single test" + RESET + "\n";
+                    current->framework.clear();
+                    return job;
+                }
+                current->cases = parseTestList(current->framework, listed.output);
+                return job;
+            });
+        }
+        scheduler.run();
+
+        std::vector<TestCase> cases;
+        for (const auto& listing : listings) {
+            const std::string& target = listing.output->target.name;
+            state_["binaries"][target] = {
+                {"key", listing.binary_key}, {"framework", listing.framework}, {"cases", listing.cases}
+            };
+
+            std::vector<std::string> names = listing.cases;
+            if (listing.framework.empty()) names = {""};
+            for (const auto& name : names) {
+                TestCase test;
+                test.target = target;
+                test.name = name;
+                test.command = testCaseCommand(listing.framework, listing.output->binary, name);
+                test.key = sha256(listing.binary_key + "\n" + listing.inputs_key + "\n" + name);
+                test.timeout = listing.timeout;
+                const json& last = member(member(state_["cases"], target), name);
+                test.last_seconds = last.value("seconds", -1.0);
+                cases.push_back(std::move(test));
+            }
+        }
+        return cases;
+    }
+
+    // The object stored under `key`, or an empty one.
+    static const json& member(const json& object, const std::string& key) {
+        static const json empty = json::object();
+        auto it = object.find(key);
+        return it != object.end() && it->is_object() ? *it : empty;
+    }
+
+    // Every regular file of an "inputs" entry, in a stable order.
+    static std::vector<std::string> inputFiles(const std::string& input) {
+        std::vector<std::string> files;
+        std::error_code ec;
+        if (fs::is_directory(input, ec)) {
+            for (fs::recursive_directory_iterator it(input, ec), end; !ec && it != end; it.increment(ec)) {
+                if (it->is_regular_file(ec)) files.push_back(it->path().generic_string());
+            }
+            std::sort(files.begin(), files.end());
+        } else {
+            files.push_back(input);
+        }
+        return files;
+    }
+
+    // Content hash of a file, reused while its mtime and size stay the same.
+    std::string hashFileCached(const std::string& path) {
+        std::error_code ec;
+        auto time = fs::last_write_time(path, ec);
+        if (ec) return "missing";
+        int64_t mtime = fileTimeTicks(time);
+        auto size = fs::file_size(path, ec);
+
+        const json& known = member(state_["files"], path);
+        if (known.value("mtime", int64_t(-1)) == mtime && known.value("size", uintmax_t(0)) == size &&
+            known.contains("sha256")) {
+            return known["sha256"];
+        }
+        std::string hash = sha256File(path);
+        state_["files"][path] = {{"mtime", mtime}, {"size", size}, {"sha256", hash}};
+        return hash;
+    }
+
+    // Cases not known to have passed before run longest first, so the run
+    // ends soon after its slowest case; new cases count as long.
+    void run(std::vector<TestCase>& cases, const TestShard& shard) {
+        std::vector<TestCase*> pending;
+        size_t cached = 0;
+        for (auto& test : cases) {
+            const json& last = member(member(state_["cases"], test.target), test.name);
+            if (!options_.rerun && last.value("passed", "") == test.key) {
+                test.status = "cached";
+                ++cached;
+            } else {
+                pending.push_back(&test);
+            }
+        }
+        std::stable_sort(pending.begin(), pending.end(), [](const TestCase* a, const TestCase* b) {
+            double left = a->last_seconds < 0 ? 1e9 : a->last_seconds;
+            double right = b->last_seconds < 0 ? 1e9 : b->last_seconds;
+            return left > right;
+        });
+
+        JobScheduler scheduler(options_.build.jobs);
+        std::cout << "🧪 Running " << pending.size() << " test(s)";
+        if (shard.count > 1) std::cout << " of shard " << shard.index << "/" << shard.count;
+        if (!pending.empty()) std::cout << " with " << std::min(scheduler.workers(), pending.size()) << " job(s)";
+        std::cout << std::endl;
+        if (cached > 0) {
+            std::cout << GREY << "♻️  " << cached << " test(s) unchanged since they last passed" << RESET << std::endl;
+        }
+
+        for (TestCase* test : pending) {
+            scheduler.add([test]() {
+                ProcessOptions options;
+                options.timeout = test->timeout;
+                auto begin = std::chrono::steady_clock::now();
+                ProcessResult result = runProcess(test->command, options);
+                test->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+                test->exit_code = result.exit_code;
+                test->output = std::move(result.output);
+                test->status = result.timed_out ? "timed out" : result.exit_code == 0 ? "passed" : "failed";
+
+                // Failing cases must not stop the others, so every job succeeds.
+                JobResult job;
+                std::ostringstream line;
+                line << std::fixed << std::setprecision(2);
+                if (test->status == "passed") {
+                    line << GREEN << "✅ " << test->label() << RESET << GREY << " (" << test->seconds << " s)" << RESET << "\n";
+                } else if (test->status == "timed out") {
+                    line << RED << "⏱️  " << test->label() << " timed out after " << test->timeout.count() << " s" << RESET
+                         << "\n" << test->output;
+                } else {
+                    line << RED << "❌ " << test->label() << " (exit code " << test->exit_code << ", " << test->seconds
+                         << " s)" << RESET << "\n" << test->output;
+                }
+                if (!test->output.empty() && test->output.back() != '\n' && test->status != "passed") line << "\n";
+                job.output = line.str();
+                return job;
+            });
+        }
+        scheduler.run();
+
+        for (const auto& test : cases) {
+            if (test.status == "cached") continue;
+            json& entry = state_["cases"][test.target][test.name];
+            entry["seconds"] = test.seconds;
+            if (test.status == "passed") {
+                entry["passed"] = test.key;
+            } else {
+                entry.erase("passed");
+            }
+        }
+    }
+
+    void report(const std::vector<TestCase>& cases) {
+        std::map<std::string, size_t> counts;
+        const TestCase* slowest = nullptr;
+        double total = 0;
+        std::vector<std::string> failed;
+        for (const auto& test : cases) {
+            ++counts[test.status];
+            total += test.seconds;
+            if (test.status != "cached" && (!slowest || test.seconds > slowest->seconds)) slowest = &test;
+            if (test.status == "failed" || test.status == "timed out") failed.push_back(test.label());
+        }
+
+        std::cout << std::fixed << std::setprecision(2) << GREY << "🧪 " << counts["passed"] << " passed, "
+                  << counts["failed"] << " failed, " << counts["timed out"] << " timed out, " << counts["cached"]
+                  << " cached; " << total << " s of tests";
+        if (slowest) std::cout << ", slowest " << slowest->label() << " (" << slowest->seconds << " s)";
+        std::cout << RESET << std::endl;
+
+        if (!failed.empty()) {
+            for (const auto& label : failed) {
+                std::cerr << RED << "   " << label << RESET << std::endl;
+            }
+            throw std::runtime_error(std::to_string(failed.size()) + " test(s) failed");
+        }
+        std::cout << GREEN << "✅ All tests passed" << RESET << std::endl;
+    }
+
+    // One <testsuite> per target. Cases skipped because they passed before
+    // are reported as skipped: this run did not execute them.
+    void writeJUnit(const std::vector<TestCase>& cases, const std::string& path) const {
+        std::map<std::string, std::vector<const TestCase*>> suites;
+        for (const auto& test : cases) {
+            suites[test.target].push_back(&test);
+        }
+
+        auto seconds = [](double value) {
+            std::ostringstream text;
+            text << std::fixed << std::setprecision(3) << value;
+            return text.str();
+        };
+
+        std::ostringstream suites_xml;
+        size_t tests = 0, failures = 0, skipped = 0;
+        double time = 0;
+        for (const auto& [target, members] : suites) {
+            size_t suite_failures = 0, suite_skipped = 0;
+            double suite_time = 0;
+            std::ostringstream cases_xml;
+            for (const TestCase* test : members) {
+                suite_time += test->seconds;
+                cases_xml << "    <testcase classname=\"" << xmlEscape(target) << "\" name=\""
+                          << xmlEscape(test->name.empty() ? target : test->name) << "\" time=\"" << seconds(test->seconds)
+                          << "\"";
+                if (test->status == "passed") {
+                    cases_xml << "/>\n";
+                    continue;
+                }
+                cases_xml << ">\n";
+                if (test->status == "cached") {
+                    ++suite_skipped;
+                    cases_xml << "      <skipped message=\"passed before with an identical binary and inputs\"/>\n";
+                } else {
+                    ++suite_failures;
+                    std::string message = test->status == "timed out"
+                        ? "timed out after " + std::to_string(test->timeout.count()) + " s"
+                        : "exit code " + std::to_string(test->exit_code);
+                    cases_xml << "      <failure message=\"" << xmlEscape(message) << "\">" << xmlEscape(test->output)
+                              << "</failure>\n";
+                }
+                cases_xml << "    </testcase>\n";
+            }
+            suites_xml << "  <testsuite name=\"" << xmlEscape(target) << "\" tests=\"" << members.size()
+                       << "\" failures=\"" << suite_failures << "\" skipped=\"" << suite_skipped << "\" time=\""
+                       << seconds(suite_time) << "\">\n" << cases_xml.str() << "  </testsuite>\n";
+            tests += members.size();
+            failures += suite_failures;
+            skipped += suite_skipped;
+            time += suite_time;
+        }
+
+        if (fs::path(path).has_parent_path()) fs::create_directories(fs::path(path).parent_path());
+        std::ofstream file(path);
+        file << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+             << "<testsuites name=\"cppkg\" tests=\"" << tests << "\" failures=\"" << failures << "\" skipped=\""
+             << skipped << "\" time=\"" << seconds(time) << "\">\n"
+             << suites_xml.str() << "</testsuites>\n";
+        std::cout << GREY << "📄 JUnit report: " << path << RESET << std::endl;
+    }
+
+    void loadState() {
+        std::ifstream file(state_path_);
+        if (file) {
+            try {
+                state_ = json::parse(file);
+            } catch (const json::parse_error&) {
+                state_ = json::object();
+            }
+        }
+        if (!state_.is_object() || state_.value("version", 0) != 1) state_ = {{"version", 1}};
+        for (const char* key : {"files", "binaries", "cases"}) {
+            if (!state_.contains(key) || !state_[key].is_object()) state_[key] = json::object();
+        }
+    }
+
+    // Written aside and renamed so concurrent runs never read half a file.
+    void saveState() const {
+        std::string temp = state_path_ + ".tmp";
+        std::ofstream(temp) << state_.dump() << "\n";
+        std::error_code ec;
+        fs::rename(temp, state_path_, ec);
+    }
+};
+
+#endif
@@ -0,0 +1,288 @@
+#ifndef QUICK_CPPKG_TOOLCHAIN_HPP
+#define QUICK_CPPKG_TOOLCHAIN_HPP
+
+#include "cache.hpp"
+#include "command.hpp"
+#include "nlohmann/json.hpp"
+#include "process.hpp"
+#include "state.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+    #include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+// What a compiler is and can do. Probing takes a dozen process spawns, so
+// the result is kept in <cache>/toolchains.json keyed on the compiler
+// binary's resolved path, mtime and size; upgrading the compiler in place
+// probes it again.
+struct Toolchain {
+    std::string compiler;                         // as invoked: g++, clang++, cl or $CXX
+    std::string path;                             // resolved binary
+    std::string version;                          // full --version output
+    std::string target;                           // -dumpmachine, e.g. x86_64-linux-gnu
+    std::vector<std::string> system_include_dirs;
+    std::vector<std::string> std_levels;          // accepted -std= values, e.g. c++17
+    std::vector<std::string> linkers;             // accepted -fuse-ld= values
+
+    bool isClang() const { return version.find("clang") != std::string::npos; }
+    bool isMsvc() const { return compiler == "cl"; }
+
+    bool supportsStd(const std::string& level) const {
+        return std_levels.empty() || std::find(std_levels.begin(), std_levels.end(), level) != std_levels.end();
+    }
+
+    bool supportsLinker(const std::string& linker) const {
+        return std::find(linkers.begin(), linkers.end(), linker) != linkers.end();
+    }
+
+    // What "linker": "auto" picks: the first of mold, lld and gold this
+    // compiler accepts. lld cannot read GCC's LTO objects, so g++ builds
+    // with LTO skip it; mold and gold use GCC's LTO plugin.
+    std::string autoLinker(bool lto) const {
+        for (const std::string candidate : {"mold", "lld", "gold"}) {
+            if (candidate == "lld" && lto && !isClang()) continue;
+            if (supportsLinker(candidate)) return candidate;
+        }
+        return "";
+    }
+
+    // From the first line of --version: "g++ (Debian 12.2.0-14) 12.2.0" or
+    // "clang version 17.0.6". 0 when it cannot be told.
+    int majorVersion() const {
+        std::string line = version.substr(0, version.find('\n'));
+        auto marker = line.find("version ");
+        std::string number = marker != std::string::npos ? line.substr(marker + 8) : line.substr(line.rfind(' ') + 1);
+        return std::atoi(number.c_str());
+    }
+
+    // What identifies the compiler's output in cache keys.
+    std::string identity() const { return version + "\n" + target; }
+
+    json toJson() const {
+        return {
+            {"compiler", compiler}, {"path", path}, {"version", version}, {"target", target},
+            {"system_include_dirs", system_include_dirs}, {"std_levels", std_levels}, {"linkers", linkers}
+        };
+    }
+
+    static Toolchain fromJson(const json& entry) {
+        Toolchain toolchain;
+        toolchain.compiler = entry.value("compiler", "");
+        toolchain.path = entry.value("path", "");
+        toolchain.version = entry.value("version", "");
+        toolchain.target = entry.value("target", "");
+        toolchain.system_include_dirs = entry.value("system_include_dirs", std::vector<std::string>{});
+        toolchain.std_levels = entry.value("std_levels", std::vector<std::string>{});
+        toolchain.linkers = entry.value("linkers", std::vector<std::string>{});
+        return toolchain;
+    }
+};
+
+// Looks `program` up in PATH without spawning anything. A program given
+// with a directory is taken as is.
+inline std::optional<fs::path> findInPath(const std::string& program) {
+    std::error_code ec;
+    auto usable = [&](const fs::path& candidate) {
+        if (!fs::is_regular_file(candidate, ec)) return false;
+        #ifdef _WIN32
+            return true;
+        #else
+            return access(candidate.c_str(), X_OK) == 0;
+        #endif
+    };
+
+    std::vector<std::string> names = {program};
+    #ifdef _WIN32
+        if (fs::path(program).extension().empty()) names = {program + ".exe", program};
+        const char separator = ';';
+    #else
+        const char separator = ':';
+    #endif
+
+    if (fs::path(program).has_parent_path()) {
+        for (const auto& name : names) {
+            if (usable(name)) return fs::absolute(name);
+        }
+        return std::nullopt;
+    }
+
+    const char* path = std::getenv("PATH");
+    std::stringstream dirs(path ? path : "");
+    std::string dir;
+    while (std::getline(dirs, dir, separator)) {
+        if (dir.empty()) dir = ".";
+        for (const auto& name : names) {
+            fs::path candidate = fs::path(dir) / name;
+            if (usable(candidate)) return candidate;
+        }
+    }
+    return std::nullopt;
+}
+
+class ToolchainProbe {
+public:
+    explicit ToolchainProbe(fs::path cache_file = CompileCache::defaultDirectory() / "toolchains.json")
+        : cache_file_(std::move(cache_file)) {}
+
+    // $CXX when set, else the first of the platform's usual compilers that
+    // is on PATH. Returns nothing if there is none.
+    std::optional<Toolchain> detect(bool refresh = false) {
+        std::vector<std::string> candidates;
+        if (const char* cxx = std::getenv("CXX"); cxx && *cxx) {
+            candidates = {cxx};
+        } else {
+            #ifdef _WIN32
+                candidates = {"clang++", "g++", "cl"};
+            #else
+                candidates = {"g++", "clang++"};
+            #endif
+        }
+
+        for (const auto& compiler : candidates) {
+            auto path = findInPath(compiler);
+            if (!path) continue;
+            return load(compiler, *path, refresh);
+        }
+        return std::nullopt;
+    }
+
+private:
+    fs::path cache_file_;
+
+    Toolchain load(const std::string& compiler, const fs::path& found, bool refresh) {
+        std::error_code ec;
+        fs::path binary = fs::canonical(found, ec);
+        if (ec) binary = found;
+
+        json stamp = {
+            {"mtime", fileTimeTicks(fs::last_write_time(binary, ec))},
+            {"size", fs::file_size(binary, ec)}
+        };
+        std::string key = compiler + "|" + binary.string();
+
+        json cache = json::object();
+        if (std::ifstream file(cache_file_); file) {
+            try {
+                cache = json::parse(file);
+            } catch (const json::parse_error&) {}
+        }
+
+        if (!refresh && cache.contains(key) && cache[key].value("stamp", json()) == stamp) {
+            return Toolchain::fromJson(cache[key]["toolchain"]);
+        }
+
+        Toolchain toolchain = probe(compiler, binary);
+        cache[key] = {{"stamp", stamp}, {"toolchain", toolchain.toJson()}};
+
+        // Written aside and renamed so concurrent builds never read half a file.
+        fs::create_directories(cache_file_.parent_path(), ec);
+        fs::path temp = cache_file_.string() + ".tmp" +
+            std::to_string(static_cast<size_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+        std::ofstream(temp) << cache.dump(2) << "\n";
+        fs::rename(temp, cache_file_, ec);
+        if (ec) fs::remove(temp, ec);
+        return toolchain;
+    }
+
+    static Toolchain probe(const std::string& compiler, const fs::path& binary) {
+        Toolchain toolchain;
+        toolchain.compiler = compiler;
+        toolchain.path = binary.string();
+        if (compiler == "cl") return toolchain;
+
+        toolchain.version = runProcess({compiler, "--version"}).output;
+        ProcessResult machine = runProcess({compiler, "-dumpmachine"});
+        if (machine.exit_code == 0) toolchain.target = machine.output.substr(0, machine.output.find_first_of("\r\n"));
+
+        #ifdef _WIN32
+            const std::string empty = "NUL";
+        #else
+            const std::string empty = "/dev/null";
+        #endif
+
+        toolchain.system_include_dirs = parseSearchList(runProcess({compiler, "-xc++", "-E", "-v", empty}).output);
+
+        for (const char* level : {"c++11", "c++14", "c++17", "c++20", "c++23", "c++26"}) {
+            if (runProcess({compiler, std::string("-std=") + level, "-xc++", "-E", empty}).exit_code == 0) {
+                toolchain.std_levels.push_back(level);
+            }
+        }
+
+        for (const char* linker : {"mold", "lld", "gold", "bfd"}) {
+            if (runProcess({compiler, std::string("-fuse-ld=") + linker, "-Wl,--version"}).exit_code == 0) {
+                toolchain.linkers.push_back(linker);
+            }
+        }
+        return toolchain;
+    }
+
+    // The "#include <...> search starts here:" block of `-E -v`.
+    static std::vector<std::string> parseSearchList(const std::string& output) {
+        std::vector<std::string> dirs;
+        std::istringstream lines(output);
+        std::string line;
+        bool inside = false;
+        while (std::getline(lines, line)) {
+            if (line.rfind("#include <...>", 0) == 0) {
+                inside = true;
+            } else if (line.rfind("End of search list", 0) == 0) {
+                break;
+            } else if (inside && !line.empty() && line[0] == ' ') {
+                std::string dir = line.substr(1);
+                auto framework = dir.find(" (framework directory)");
+                if (framework != std::string::npos) dir.erase(framework);
+                dirs.push_back(fs::path(dir).lexically_normal().string());
+            }
+        }
+        return dirs;
+    }
+};
+
+// `cppkg toolchain`: shows the compiler builds use, probing it if needed.
+class ToolchainHandler : public CommandHandler {
+public:
+    explicit ToolchainHandler(bool refresh) : refresh_(refresh) {}
+
+    void execute() override {
+        auto toolchain = ToolchainProbe().detect(refresh_);
+        if (!toolchain) {
+            throw std::runtime_error("No C++ compiler found; install g++ or clang++, or point CXX at one");
+        }
+
+        auto join = [](const std::vector<std::string>& items) {
+            std::string text;
+            for (const auto& item : items) text += (text.empty() ? "" : " ") + item;
+            return text.empty() ? "-" : text;
+        };
+
+        std::string version = toolchain->version.substr(0, toolchain->version.find('\n'));
+        std::cout << "Compiler:   " << toolchain->compiler << " (" << toolchain->path << ")\n"
+                  << "Version:    " << (version.empty() ? "-" : version) << "\n"
+                  << "Target:     " << (toolchain->target.empty() ? "-" : toolchain->target) << "\n"
+                  << "Standards:  " << join(toolchain->std_levels) << "\n"
+                  << "Linkers:    " << join(toolchain->linkers) << "\n"
+                  << "System include directories:\n";
+        for (const auto& dir : toolchain->system_include_dirs) {
+            std::cout << "  " << dir << "\n";
+        }
+    }
+
+private:
+    bool refresh_;
+};
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef QUICK_CPPKG_TRACE_HPP
+#define QUICK_CPPKG_TRACE_HPP
+
+#include "nlohmann/json.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+// Records what a build spent its time on and writes it in the Chrome trace
+// event format (load it in chrome://tracing or https://ui.perfetto.dev).
+// Thread 0 is the main thread; compile jobs run on threads 1..N, one per
+// scheduler worker. A disabled trace records nothing.
+class BuildTrace {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit BuildTrace(bool enabled = false) : enabled_(enabled), origin_(Clock::now()) {}
+
+    bool enabled() const { return enabled_; }
+
+    // Records [begin, end) on thread `tid`.
+    void complete(const std::string& name, const std::string& category, Clock::time_point begin,
+                  Clock::time_point end, size_t tid = 0, json args = json::object()) {
+        if (!enabled_) return;
+
+        Event event{name, category, micros(begin), micros(end) - micros(begin), tid, std::move(args)};
+        std::lock_guard<std::mutex> lock(mutex_);
+        events_.push_back(std::move(event));
+    }
+
+    // Times the enclosing scope on the main thread.
+    class Span {
+    public:
+        Span(BuildTrace& trace, std::string name, std::string category)
+            : trace_(trace), name_(std::move(name)), category_(std::move(category)), begin_(Clock::now()) {}
+        ~Span() { trace_.complete(name_, category_, begin_, Clock::now()); }
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+    private:
+        BuildTrace& trace_;
+        std::string name_;
+        std::string category_;
+        Clock::time_point begin_;
+    };
+
+    Span span(const std::string& name, const std::string& category = "phase") {
+        return Span(*this, name, category);
+    }
+
+    // Merges a clang -ftime-trace file recorded by a compile that started at
+    // `begin` on thread `tid`, nesting its events under that job.
+    void mergeClangTrace(const std::string& path, Clock::time_point begin, size_t tid) {
+        if (!enabled_) return;
+
+        std::ifstream file(path);
+        if (!file) return;
+
+        json data = json::parse(file, nullptr, false);
+        if (data.is_discarded() || !data.contains("traceEvents")) return;
+
+        int64_t offset = micros(begin);
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& entry : data["traceEvents"]) {
+            if (entry.value("ph", "") != "X" || !entry.contains("ts") || !entry.contains("dur")) continue;
+
+            // Clang's totals ("Total Frontend", ...) start at 0 and repeat
+            // the detail events; keep only the detail.
+            std::string name = entry.value("name", "");
+            if (name.rfind("Total ", 0) == 0) continue;
+
+            events_.push_back({name, "clang", offset + entry["ts"].get<int64_t>(), entry["dur"].get<int64_t>(),
+                               tid, entry.value("args", json::object())});
+        }
+    }
+
+    bool write(const std::string& path, size_t workers) const {
+        json events = json::array();
+        events.push_back(threadName(0, "main"));
+        for (size_t tid = 1; tid <= workers; ++tid) {
+            events.push_back(threadName(tid, "worker " + std::to_string(tid)));
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& event : events_) {
+            events.push_back({
+                {"name", event.name},
+                {"cat", event.category},
+                {"ph", "X"},
+                {"ts", event.start},
+                {"dur", event.duration},
+                {"pid", 1},
+                {"tid", event.tid},
+                {"args", event.args}
+            });
+        }
+
+        std::ofstream file(path);
+        if (!file) return false;
+        file << json{{"traceEvents", events}, {"displayTimeUnit", "ms"}}.dump() << "\n";
+        return static_cast<bool>(file);
+    }
+
+    // The phases in the order they ran and the `top` slowest events of
+    // `category`, as a printable table.
+    std::string summary(const std::string& category, size_t top) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1);
+
+        for (const auto& event : events_) {
+            if (event.category == "phase") {
+                out << "  " << std::setw(9) << event.duration / 1000.0 << " ms  " << event.name << "\n";
+            }
+        }
+
+        std::vector<const Event*> slowest;
+        for (const auto& event : events_) {
+            if (event.category == category) slowest.push_back(&event);
+        }
+        std::sort(slowest.begin(), slowest.end(), [](const Event* a, const Event* b) {
+            return a->duration > b->duration;
+        });
+        if (slowest.size() > top) slowest.resize(top);
+
+        if (!slowest.empty()) out << "  Slowest " << category << " steps:\n";
+        for (const Event* event : slowest) {
+            out << "  " << std::setw(9) << event->duration / 1000.0 << " ms  " << event->name << "\n";
+        }
+        return out.str();
+    }
+
+private:
+    struct Event {
+        std::string name;
+        std::string category;
+        int64_t start;    // microseconds since the trace began
+        int64_t duration; // microseconds
+        size_t tid;
+        json args;
+    };
+
+    bool enabled_;
+    Clock::time_point origin_;
+    std::vector<Event> events_;
+    mutable std::mutex mutex_;
+
+    int64_t micros(Clock::time_point time) const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(time - origin_).count();
+    }
+
+    static json threadName(size_t tid, const std::string& name) {
+        return {{"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", tid}, {"args", {{"name", name}}}};
+    }
+};
+
+#endif
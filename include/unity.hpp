@@ -0,0 +1,56 @@
+#ifndef QUICK_CPPKG_UNITY_HPP
+#define QUICK_CPPKG_UNITY_HPP
+
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct UnityBatch {
+    std::string path;
+    std::vector<std::string> sources;
+};
+
+// Splits `sources` into unity batches of at most `batch_size` files. Files
+// are grouped per directory and taken in path order, so adding or removing
+// a file only reshuffles the batches of its own directory. The batches of
+// src/ become <base>/src/unity_0.cpp, unity_1.cpp, ...
+inline std::vector<UnityBatch> planUnityBatches(std::vector<std::string> sources, size_t batch_size,
+                                                const std::string& base_directory) {
+    std::map<std::string, std::vector<std::string>> by_directory;
+    for (auto& source : sources) {
+        source = fs::path(source).lexically_normal().generic_string();
+        by_directory[fs::path(source).parent_path().generic_string()].push_back(source);
+    }
+
+    std::vector<UnityBatch> batches;
+    for (auto& [directory, files] : by_directory) {
+        std::sort(files.begin(), files.end());
+
+        fs::path base = fs::path(base_directory) / directory;
+        for (size_t start = 0, index = 0; start < files.size(); start += batch_size, ++index) {
+            UnityBatch batch;
+            batch.path = (base / ("unity_" + std::to_string(index) + ".cpp")).generic_string();
+            size_t end = std::min(files.size(), start + batch_size);
+            batch.sources.assign(files.begin() + static_cast<std::ptrdiff_t>(start),
+                                 files.begin() + static_cast<std::ptrdiff_t>(end));
+            batches.push_back(std::move(batch));
+        }
+    }
+    return batches;
+}
+
+// The text of a unity file: one #include per member, relative to the file.
+inline std::string unitySource(const UnityBatch& batch) {
+    fs::path directory = fs::path(batch.path).parent_path();
+    std::string text = "// Generated by cppkg for a unity build; do not edit.\n";
+    for (const auto& source : batch.sources) {
+        text += "#include \"" + fs::path(source).lexically_relative(directory).generic_string() + "\"\n";
+    }
+    return text;
+}
+
+#endif
@@ -0,0 +1,223 @@
+#ifndef QUICK_CPPKG_WATCH_HPP
+#define QUICK_CPPKG_WATCH_HPP
+
+#include "state.hpp"
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+    #include <cerrno>
+    #include <cstring>
+    #include <poll.h>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+struct FileChanges {
+    std::set<std::string> paths; // normalized, relative to the project
+    bool structure = false;      // files or directories were created, removed or renamed
+    bool overflow = false;       // events were lost; assume anything changed
+};
+
+// Reports changes below a set of directories (recursively, skipping the
+// same directories scanTree does) and to a few individual files. On Linux
+// this is inotify; elsewhere the watched trees are polled.
+class FileWatcher {
+public:
+    FileWatcher(const std::vector<std::string>& roots, const std::vector<std::string>& files)
+        : roots_(roots) {
+        for (const auto& file : files) {
+            files_.insert(fs::path(file).lexically_normal().generic_string());
+        }
+#ifdef __linux__
+        fd_ = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+        if (fd_ < 0) throw std::runtime_error(std::string("inotify_init1: ") + std::strerror(errno));
+        for (const auto& root : roots_) {
+            watchTree(root);
+        }
+        // The files are watched through their directories, filtered by name.
+        for (const auto& file : files_) {
+            std::string directory = fs::path(file).parent_path().generic_string();
+            watchDirectory(directory.empty() ? "." : directory);
+        }
+#else
+        snapshot_ = snapshot();
+#endif
+    }
+
+    ~FileWatcher() {
+#ifdef __linux__
+        if (fd_ >= 0) close(fd_);
+#endif
+    }
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Blocks until something changes, then keeps collecting until nothing
+    // has happened for `debounce`, so an editor saving several files (or
+    // writing one in several steps) causes a single rebuild.
+    FileChanges wait(std::chrono::milliseconds debounce) {
+        FileChanges changes;
+#ifdef __linux__
+        int timeout = -1;
+        while (true) {
+            pollfd pfd{fd_, POLLIN, 0};
+            int ready = ::poll(&pfd, 1, timeout);
+            if (ready < 0 && errno == EINTR) continue;
+            if (ready <= 0) {
+                if (!changes.paths.empty() || changes.overflow) break;
+                continue;
+            }
+            drain(changes);
+            if (!changes.paths.empty() || changes.overflow) timeout = static_cast<int>(debounce.count());
+        }
+#else
+        while (true) {
+            std::this_thread::sleep_for(std::max(debounce, std::chrono::milliseconds(250)));
+            auto current = snapshot();
+            bool quiet = true;
+            for (const auto& [path, mtime] : current) {
+                auto it = snapshot_.find(path);
+                if (it == snapshot_.end() || it->second != mtime) {
+                    changes.paths.insert(path);
+                    changes.structure = changes.structure || it == snapshot_.end();
+                    quiet = false;
+                }
+            }
+            for (const auto& [path, mtime] : snapshot_) {
+                if (!current.count(path)) {
+                    changes.paths.insert(path);
+                    changes.structure = true;
+                    quiet = false;
+                }
+            }
+            snapshot_ = std::move(current);
+            if (quiet && !changes.paths.empty()) break;
+        }
+#endif
+        return changes;
+    }
+
+private:
+    std::vector<std::string> roots_;
+    std::set<std::string> files_;
+
+    bool isWatchedFile(const std::string& path) const {
+        return files_.count(path) > 0;
+    }
+
+    bool isBelowRoot(const std::string& path) const {
+        for (const auto& root : roots_) {
+            std::string normalized = fs::path(root).lexically_normal().generic_string();
+            if (normalized == "." || path == normalized || path.rfind(normalized + "/", 0) == 0) return true;
+        }
+        return false;
+    }
+
+#ifdef __linux__
+    int fd_ = -1;
+    std::map<int, std::string> directories_; // watch descriptor -> directory
+
+    static constexpr uint32_t kMask = IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE |
+                                      IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF;
+
+    void watchDirectory(const std::string& directory) {
+        int wd = inotify_add_watch(fd_, directory.c_str(), kMask);
+        if (wd >= 0) directories_[wd] = fs::path(directory).lexically_normal().generic_string();
+    }
+
+    void watchTree(const std::string& root) {
+        std::error_code ec;
+        if (!fs::is_directory(root, ec)) return;
+        watchDirectory(root);
+
+        for (auto it = fs::recursive_directory_iterator(root, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+            std::error_code type_ec;
+            if (!it->is_directory(type_ec)) continue;
+            if (isIgnoredDirectory(it->path())) {
+                it.disable_recursion_pending();
+                continue;
+            }
+            watchDirectory(it->path().string());
+        }
+    }
+
+    void drain(FileChanges& changes) {
+        alignas(inotify_event) char buffer[16384];
+        while (true) {
+            ssize_t n = read(fd_, buffer, sizeof(buffer));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return;
+
+            for (char* p = buffer; p < buffer + n;) {
+                auto* event = reinterpret_cast<inotify_event*>(p);
+                p += sizeof(inotify_event) + event->len;
+
+                if (event->mask & IN_Q_OVERFLOW) {
+                    changes.overflow = true;
+                    continue;
+                }
+                if (event->mask & IN_IGNORED) {
+                    directories_.erase(event->wd);
+                    continue;
+                }
+
+                auto directory = directories_.find(event->wd);
+                if (directory == directories_.end()) continue;
+
+                std::string name = event->len ? event->name : "";
+                std::string path = directory->second;
+                if (!name.empty()) path = (fs::path(path) / name).lexically_normal().generic_string();
+
+                if (!isWatchedFile(path) && !isBelowRoot(path)) continue;
+                // Editor swap and backup files.
+                if (!name.empty() && (name[0] == '.' || name.back() == '~') && !isWatchedFile(path)) continue;
+                if ((event->mask & IN_ISDIR) && isIgnoredDirectory(path)) continue;
+
+                changes.paths.insert(path);
+                if (event->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF)) {
+                    changes.structure = true;
+                }
+                // A new directory may already hold files by the time it is watched.
+                if ((event->mask & (IN_CREATE | IN_MOVED_TO)) && (event->mask & IN_ISDIR)) {
+                    watchTree(path);
+                }
+            }
+        }
+    }
+#else
+    std::map<std::string, fs::file_time_type> snapshot_;
+
+    std::map<std::string, fs::file_time_type> snapshot() const {
+        std::map<std::string, fs::file_time_type> files;
+        std::error_code ec;
+        for (const auto& root : roots_) {
+            if (!fs::is_directory(root, ec)) continue;
+            for (auto it = fs::recursive_directory_iterator(root, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+                std::error_code type_ec;
+                if (it->is_directory(type_ec)) {
+                    if (isIgnoredDirectory(it->path())) it.disable_recursion_pending();
+                    continue;
+                }
+                files[it->path().lexically_normal().generic_string()] = it->last_write_time(type_ec);
+            }
+        }
+        for (const auto& file : files_) {
+            auto time = fs::last_write_time(file, ec);
+            if (!ec) files[file] = time;
+        }
+        return files;
+    }
+#endif
+};
+
+#endif
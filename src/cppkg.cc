@@ -7,8 +7,14 @@
 
 #include "init.hpp"
 #include "add.hpp"
+#include "analyze.hpp"
 #include "build.hpp"
 #include "run.hpp"
+#include "cache.hpp"
+#include "doctor.hpp"
+#include "remote.hpp"
+#include "test.hpp"
+#include "toolchain.hpp"
 
 namespace fs = std::filesystem;
 
@@ -50,11 +56,123 @@ int main(int argc, char* argv[]) {
     add_cmd->add_option("packages", packages, "Package names with optional @version")
         ->required();
 
+    BuildOptions build_options;
     auto build_cmd = app.add_subcommand("build", "Build the project")
         ->alias("compile");
+    build_cmd->add_option("-j,--jobs", build_options.jobs, "Number of parallel compile jobs (default: all cores)");
+    build_cmd->add_flag("!--no-cache", build_options.use_cache, "Bypass the compilation cache");
+    build_cmd->add_option("--unity", build_options.unity, "Compile sources in unity batches of N files")
+        ->expected(0, 1)
+        ->default_str("8");
+    build_cmd->add_option("--profile", build_options.profile, "Build profile: debug, release, relwithdebinfo or one from cppkg.json")
+        ->capture_default_str();
+    auto pgo_generate = build_cmd->add_flag_callback("--pgo-generate", [&build_options]() { build_options.pgo = "generate"; },
+        "Build an instrumented binary that records a PGO profile");
+    build_cmd->add_flag_callback("--pgo-use", [&build_options]() { build_options.pgo = "use"; },
+        "Optimize using the profile recorded by a --pgo-generate build")
+        ->excludes(pgo_generate);
+    build_cmd->add_flag("--trace", build_options.trace, "Write a Chrome trace of the build to build/cppkg-trace.json");
+    build_cmd->add_option("--generator", build_options.generator, "Run the build with cppkg's own scheduler or write build.ninja and run ninja")
+        ->check(CLI::IsMember({"cppkg", "ninja"}))
+        ->capture_default_str();
+    build_cmd->add_flag("--watch", build_options.watch, "Rebuild whenever a source, header or cppkg.json changes");
+    const auto sanitizers = CLI::IsMember({"address", "undefined", "thread", "leak"});
+    build_cmd->add_option("--sanitize", build_options.sanitize, "Instrument with sanitizers, e.g. address,undefined or thread")
+        ->delimiter(',')
+        ->allow_extra_args(false)
+        ->check(sanitizers);
+    build_cmd->add_flag("--coverage", build_options.coverage, "Instrument for code coverage");
+    build_cmd->add_option("--worker", build_options.workers, "Send compiles to the `cppkg worker` at host:port or unix:/path (default: $CPPKG_WORKERS)")
+        ->delimiter(',')
+        ->allow_extra_args(false);
 
+    BuildOptions run_options;
+    std::string run_target;
     auto run_cmd = app.add_subcommand("run", "Run the project")
         ->alias("start");
+    run_cmd->add_option("--profile", run_options.profile, "Build profile whose executable to run")
+        ->capture_default_str();
+    run_cmd->add_option("--sanitize", run_options.sanitize, "Run the build instrumented with these sanitizers")
+        ->delimiter(',')
+        ->allow_extra_args(false)
+        ->check(sanitizers);
+    run_cmd->add_flag("--coverage", run_options.coverage, "Run the coverage build, collecting its profile");
+    auto run_watch = run_cmd->add_flag("--watch", run_options.watch, "Rebuild and restart the program whenever the project changes");
+    BenchOptions bench_options;
+    run_cmd->add_option("--bench", bench_options.runs, "Benchmark the program over N measured runs")
+        ->expected(0, 1)
+        ->default_str("10")
+        ->excludes(run_watch);
+    run_cmd->add_option("--warmup", bench_options.warmup, "Runs before measuring")
+        ->capture_default_str();
+    run_cmd->add_option("--pin", bench_options.cpus, "Pin the benchmarked program to these CPUs, e.g. 2 or 2,3")
+        ->delimiter(',')
+        ->allow_extra_args(false);
+    run_cmd->add_flag("--counters", bench_options.counters, "Also read cycles, instructions and cache misses from perf events");
+    run_cmd->add_option("--baseline", bench_options.baseline, "Baseline JSON to compare with (default: build/<profile>/bench/<target>.json)");
+    run_cmd->add_flag("--save-baseline", bench_options.save_baseline, "Store this benchmark as the new baseline");
+    run_cmd->add_option("--threshold", bench_options.threshold, "Percent a median may worsen before it counts as a regression")
+        ->capture_default_str();
+    run_cmd->add_option("target", run_target, "Executable target to run (default: the one named after the project)");
+
+    TestHandler::Options test_options;
+    auto test_cmd = app.add_subcommand("test", "Build and run the test targets");
+    test_cmd->add_option("-j,--jobs", test_options.build.jobs, "Number of parallel compile jobs and test cases (default: all cores)");
+    test_cmd->add_option("--profile", test_options.build.profile, "Build profile to test")
+        ->capture_default_str();
+    test_cmd->add_option("--sanitize", test_options.build.sanitize, "Test the build instrumented with these sanitizers")
+        ->delimiter(',')
+        ->allow_extra_args(false)
+        ->check(sanitizers);
+    test_cmd->add_flag("--coverage", test_options.build.coverage, "Test the coverage build, collecting its profile");
+    test_cmd->add_option("--shard", test_options.shard, "Run only the i-th of n slices of the test cases, e.g. 2/4")
+        ->check([](const std::string& shard) {
+            try {
+                TestShard::parse(shard);
+                return std::string();
+            } catch (const std::exception& e) {
+                return std::string(e.what());
+            }
+        });
+    test_cmd->add_option("--timeout", test_options.timeout, "Seconds each test case may run (default: the target's \"timeout\", else 300)");
+    test_cmd->add_flag("--rerun", test_options.rerun, "Also run tests that passed before with an identical binary and inputs");
+    test_cmd->add_option("--junit", test_options.junit, "Where to write the JUnit XML report (default: build/<profile>/test-results.xml)");
+    test_cmd->add_option("targets", test_options.targets, "Test targets to run (default: all)");
+
+    auto cache_cmd = app.add_subcommand("cache", "Manage the compilation cache");
+    cache_cmd->add_subcommand("stats", "Show cache hit rate and size");
+    auto cache_clear_cmd = cache_cmd->add_subcommand("clear", "Remove all cached objects");
+    cache_cmd->require_subcommand(1);
+
+    bool toolchain_refresh = false;
+    auto toolchain_cmd = app.add_subcommand("toolchain", "Show the detected compiler toolchain");
+    toolchain_cmd->add_flag("--refresh", toolchain_refresh, "Probe the compiler again instead of using the cached result");
+
+    std::string worker_listen = kDefaultWorkerAddress;
+    size_t worker_jobs = 0;
+    auto worker_cmd = app.add_subcommand("worker", "Compile for builds on other machines");
+    worker_cmd->add_option("--listen", worker_listen, "Address to listen on: host:port or unix:/path")
+        ->capture_default_str();
+    worker_cmd->add_option("-j,--jobs", worker_jobs, "Compiles to run at once (default: all cores)");
+
+    std::string doctor_profile = "debug";
+    auto doctor_cmd = app.add_subcommand("doctor", "Diagnose the project setup");
+    auto doctor_includes_cmd = doctor_cmd->add_subcommand("includes", "Show which include directories the last build used");
+    doctor_includes_cmd->add_option("--profile", doctor_profile, "Build profile to inspect")
+        ->capture_default_str();
+    doctor_cmd->require_subcommand(1);
+
+    std::string analyze_profile = "debug";
+    size_t analyze_top = 20;
+    size_t analyze_jobs = 0;
+    auto analyze_cmd = app.add_subcommand("analyze", "Analyze what the build spends its time on");
+    auto analyze_includes_cmd = analyze_cmd->add_subcommand("includes", "Show which headers cost the most to parse and which includes can go");
+    analyze_includes_cmd->add_option("--profile", analyze_profile, "Build profile to analyze")
+        ->capture_default_str();
+    analyze_includes_cmd->add_option("--top", analyze_top, "Number of headers and findings to list")
+        ->capture_default_str();
+    analyze_includes_cmd->add_option("-j,--jobs", analyze_jobs, "Headers to preprocess at once (default: all cores)");
+    analyze_cmd->require_subcommand(1);
 
     try {
         app.parse(argc, argv);
@@ -74,10 +192,28 @@ int main(int argc, char* argv[]) {
             AddHandler handler(packages);
             handler.execute();
         } else if (app.got_subcommand(build_cmd)) {
-            BuildHandler handler;
+            BuildHandler handler(build_options);
             handler.execute();
         } else if (app.got_subcommand(run_cmd)){
-            RunHandler handler;
+            RunHandler handler(run_options, run_target, bench_options);
+            handler.execute();
+        } else if (app.got_subcommand(test_cmd)) {
+            TestHandler handler(test_options);
+            handler.execute();
+        } else if (app.got_subcommand(cache_cmd)) {
+            CacheHandler handler(cache_cmd->got_subcommand(cache_clear_cmd) ? "clear" : "stats");
+            handler.execute();
+        } else if (app.got_subcommand(toolchain_cmd)) {
+            ToolchainHandler handler(toolchain_refresh);
+            handler.execute();
+        } else if (app.got_subcommand(worker_cmd)) {
+            WorkerHandler handler(worker_listen, worker_jobs);
+            handler.execute();
+        } else if (app.got_subcommand(analyze_cmd)) {
+            AnalyzeHandler handler("includes", analyze_profile, analyze_top, analyze_jobs);
+            handler.execute();
+        } else if (app.got_subcommand(doctor_cmd)) {
+            DoctorHandler handler("includes", doctor_profile);
             handler.execute();
         } else {
             std::cout << app.help();
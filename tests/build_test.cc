@@ -0,0 +1,65 @@
+// Runs the cppkg binary on small generated projects and checks how
+// `cppkg build` reports the outcome.
+#include "check.hpp"
+#include "process.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+#ifndef CPPKG_BINARY
+#define CPPKG_BINARY "cppkg"
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+fs::path makeProject(const std::string& name) {
+    fs::path root = fs::temp_directory_path() / ("cppkg_build_test_" + name);
+    fs::remove_all(root);
+    writeTestFile(root / "cppkg.json",
+                  R"({"name": "app", "version": "0.1.0", "cpp_version": "c++17", "exec": "src/main.cpp", "dependencies": {}})");
+    writeTestFile(root / "src" / "main.cpp", "int main() { return 0; }\n");
+    return root;
+}
+
+ProcessResult build(const fs::path& root) {
+    fs::current_path(root);
+    return runProcess({CPPKG_BINARY, "build"});
+}
+
+void buildSucceeds() {
+    fs::path root = makeProject("ok");
+    ProcessResult result = build(root);
+    CHECK(result.exit_code == 0);
+    fs::current_path(fs::temp_directory_path());
+    fs::remove_all(root);
+}
+
+void failedCompileFailsTheCommand() {
+    fs::path root = makeProject("bad");
+    writeTestFile(root / "src" / "bad.cpp", "int broken( { return 0; }\n");
+    ProcessResult result = build(root);
+    CHECK(result.exit_code != 0);
+    CHECK(result.output.find("Build failed") != std::string::npos);
+    fs::current_path(fs::temp_directory_path());
+    fs::remove_all(root);
+}
+
+} // namespace
+
+int main() {
+    // Keep the user's compilation cache out of it.
+    std::string cache = (fs::temp_directory_path() / "cppkg_build_test_cache").string();
+#ifdef _WIN32
+    _putenv_s("CPPKG_CACHE_DIR", cache.c_str());
+#else
+    setenv("CPPKG_CACHE_DIR", cache.c_str(), 1);
+#endif
+
+    buildSucceeds();
+    failedCompileFailsTheCommand();
+    fs::remove_all(cache);
+    return checkFailures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,29 @@
+#ifndef QUICK_CPPKG_TESTS_CHECK_HPP
+#define QUICK_CPPKG_TESTS_CHECK_HPP
+
+// A few lines of test harness: CHECK records a failure and carries on, and
+// a test's main() returns checkFailures() so ctest sees them.
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+inline int& checkFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                                      \
+    do {                                                                                      \
+        if (!(condition)) {                                                                   \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed\n"; \
+            ++checkFailures();                                                                \
+        }                                                                                     \
+    } while (0)
+
+inline void writeTestFile(const std::filesystem::path& path, const std::string& content) {
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream(path) << content;
+}
+
+#endif // QUICK_CPPKG_TESTS_CHECK_HPP
@@ -0,0 +1,46 @@
+// Which compiler flags a `cppkg worker` runs for a client.
+#include "check.hpp"
+#include "remote.hpp"
+
+namespace {
+
+void acceptsCodeGenerationAndDiagnostics() {
+    for (const char* arg : {"-std=c++20", "-O2", "-g", "-Wall", "-Werror=return-type", "-march=native", "-pthread",
+                            "-fPIC", "-fno-plt", "-fvisibility=hidden", "-flto=thin", "-fno-exceptions",
+                            "-fsanitize=address,undefined", "-fdiagnostics-color=always"}) {
+        CHECK(remoteArgumentAllowed(arg));
+    }
+}
+
+void refusesPlugins() {
+    CHECK(!remoteArgumentAllowed("-fpass-plugin=/tmp/evil.so"));
+    CHECK(!remoteArgumentAllowed("-fpass-plugin=evil.so"));
+    CHECK(!remoteArgumentAllowed("-fplugin=./evil.so"));
+    CHECK(!remoteArgumentAllowed("-mllvm"));
+}
+
+void refusesOptionsThatWriteFiles() {
+    CHECK(!remoteArgumentAllowed("-fopt-info-all=/home/user/.bashrc"));
+    CHECK(!remoteArgumentAllowed("-fopt-info-vec-missed=opt.txt"));
+    CHECK(!remoteArgumentAllowed("-fsave-optimization-record"));
+    CHECK(!remoteArgumentAllowed("-fdump-tree-all"));
+    CHECK(!remoteArgumentAllowed("-gsplit-dwarf"));
+    CHECK(!remoteArgumentAllowed("-Wl,-o,/tmp/x"));
+}
+
+void refusesPathValues() {
+    CHECK(!remoteArgumentAllowed("-fsanitize-ignorelist=ignore.txt"));
+    CHECK(!remoteArgumentAllowed("-fvisibility=/etc/passwd"));
+    CHECK(!remoteArgumentAllowed("-march=../x"));
+    CHECK(!remoteArgumentAllowed("@args.rsp"));
+}
+
+} // namespace
+
+int main() {
+    acceptsCodeGenerationAndDiagnostics();
+    refusesPlugins();
+    refusesOptionsThatWriteFiles();
+    refusesPathValues();
+    return checkFailures() == 0 ? 0 : 1;
+}
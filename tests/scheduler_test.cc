@@ -0,0 +1,52 @@
+// JobScheduler ordering and failure handling.
+#include "check.hpp"
+#include "scheduler.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+void runsDependenciesFirst() {
+    JobScheduler scheduler(4);
+    std::mutex mutex;
+    std::vector<int> order;
+    auto record = [&](int id) {
+        return [&, id]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(id);
+            return JobResult{};
+        };
+    };
+    size_t first = scheduler.add(record(1));
+    size_t second = scheduler.add(record(2), {first});
+    scheduler.add(record(3), {second});
+    CHECK(scheduler.run());
+    CHECK((order == std::vector<int>{1, 2, 3}));
+}
+
+void throwingJobFailsTheRun() {
+    JobScheduler scheduler(2);
+    std::atomic<bool> dependent_ran{false};
+    size_t failing = scheduler.add([]() -> JobResult { throw std::runtime_error("disk full"); });
+    scheduler.add([&]() {
+        dependent_ran = true;
+        return JobResult{};
+    }, {failing});
+    CHECK(!scheduler.run());
+    CHECK(!dependent_ran);
+
+    // The scheduler is usable again after a failed run.
+    scheduler.add([]() { return JobResult{}; });
+    CHECK(scheduler.run());
+}
+
+} // namespace
+
+int main() {
+    runsDependenciesFirst();
+    throwingJobFailsTheRun();
+    return checkFailures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,47 @@
+// Decisions made from a probed Toolchain.
+#include "check.hpp"
+#include "toolchain.hpp"
+
+namespace {
+
+Toolchain gcc(std::vector<std::string> linkers) {
+    Toolchain toolchain;
+    toolchain.compiler = "g++";
+    toolchain.version = "g++ (Debian 12.2.0-14) 12.2.0";
+    toolchain.linkers = std::move(linkers);
+    return toolchain;
+}
+
+Toolchain clang(std::vector<std::string> linkers) {
+    Toolchain toolchain;
+    toolchain.compiler = "clang++";
+    toolchain.version = "Debian clang version 17.0.6";
+    toolchain.linkers = std::move(linkers);
+    return toolchain;
+}
+
+void prefersMoldThenLldThenGold() {
+    CHECK(gcc({"bfd", "gold", "lld", "mold"}).autoLinker(false) == "mold");
+    CHECK(gcc({"bfd", "gold", "lld"}).autoLinker(false) == "lld");
+    CHECK(gcc({"bfd", "gold"}).autoLinker(false) == "gold");
+    CHECK(gcc({"bfd"}).autoLinker(false).empty());
+}
+
+void gccLtoSkipsLld() {
+    CHECK(gcc({"bfd", "gold", "lld"}).autoLinker(true) == "gold");
+    CHECK(gcc({"bfd", "lld"}).autoLinker(true).empty());
+    CHECK(gcc({"gold", "lld", "mold"}).autoLinker(true) == "mold");
+}
+
+void clangLtoKeepsLld() {
+    CHECK(clang({"bfd", "gold", "lld"}).autoLinker(true) == "lld");
+}
+
+} // namespace
+
+int main() {
+    prefersMoldThenLldThenGold();
+    gccLtoSkipsLld();
+    clangLtoKeepsLld();
+    return checkFailures() == 0 ? 0 : 1;
+}